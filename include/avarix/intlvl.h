@@ -13,7 +13,9 @@
 #ifndef AVARIX_INTLVL_H__
 #define AVARIX_INTLVL_H__
 
+#ifndef HOST_VERSION
 #include <avr/io.h>
+#endif
 #include <stdint.h>
 
 
@@ -82,6 +84,15 @@ typedef enum {
  */
 #define INTLVL_ENABLE_BLOCK_BM(lvlbm)
 
+#elif defined(HOST_VERSION)
+
+// no interrupts on host, blocks are simply executed
+#define INTLVL_DISABLE_BLOCK_BM(lvlbm) \
+    for(uint8_t avarix__tmp__ = 1; avarix__tmp__; avarix__tmp__=0)
+
+#define INTLVL_ENABLE_BLOCK_BM(lvlbm) \
+    for(uint8_t avarix__tmp__ = 1; avarix__tmp__; avarix__tmp__=0)
+
 #else
 
 static inline void avarix__restore_lvlen(const uint8_t *lvlbm)
@@ -4,17 +4,38 @@
  */
 #include <stdint.h>
 #include <math.h>
-#include <avr/cpufunc.h>
-#include <util/atomic.h>
-#include <util/parity.h>
-#include <clock/defs.h>
-#include <util/delay.h>
+#include <avarix/intlvl.h>
 #include "adxrs.h"
 #include "adxrs_config.h"
+#ifdef HOST_VERSION
+// no SPI, interrupts nor ports on host
+// capture transfers are run by adxrs_host_capture()
+# define parity_even_bit(v)  __builtin_parity(v)
+# define _delay_ms(ms)
+# define _NOP()
+# define portpin_dirset(pp)
+# define portpin_outset(pp)
+# define portpin_outclr(pp)
+# undef ADXRS_CAPTURE_DMA_CH
+# ifdef ADXRS_CALIBRATION_EEPROM_SLOTS
+#  error ADXRS_CALIBRATION_EEPROM_SLOTS is not supported on host
+# endif
+# include <stddef.h>
+#else
+# include <avr/cpufunc.h>
+# include <util/atomic.h>
+# include <util/parity.h>
+# include <clock/defs.h>
+# include <util/delay.h>
+#endif
+#ifdef ADXRS_CALIBRATION_EEPROM_SLOTS
+# include <stddef.h>
+# include <stdlib.h>
+# include <avr/eeprom.h>
+# include <util/crc16.h>
+#endif
 
-#define T int16_t
-#include "fifo.h"
-#undef T
+#ifndef HOST_VERSION
 
 #if (CLOCK_PER_FREQ / ADXRS_SPI_PRESCALER) > 8080000
 # error ADXRS_SPI_PRESCALER is too low, max ADXRS SPI frequency is 8.08MHz
@@ -32,6 +53,7 @@
 # endif
 # define ADXRS_SPI  SPIC
 # define ADXRS_SPI_INT_vect  SPIC_INT_vect
+# define ADXRS_DMA_TRIGSRC  DMA_CH_TRIGSRC_SPIC_gc
 #endif
 
 #ifdef ADXRS_SPID_ENABLE
@@ -40,6 +62,7 @@
 # endif
 # define ADXRS_SPI  SPID
 # define ADXRS_SPI_INT_vect  SPID_INT_vect
+# define ADXRS_DMA_TRIGSRC  DMA_CH_TRIGSRC_SPID_gc
 #endif
 
 #ifdef ADXRS_SPIE_ENABLE
@@ -48,6 +71,7 @@
 # endif
 # define ADXRS_SPI  SPIE
 # define ADXRS_SPI_INT_vect  SPIE_INT_vect
+# define ADXRS_DMA_TRIGSRC  DMA_CH_TRIGSRC_SPIE_gc
 #endif
 
 #ifdef ADXRS_SPIF_ENABLE
@@ -56,63 +80,132 @@
 # endif
 # define ADXRS_SPI  SPIF
 # define ADXRS_SPI_INT_vect  SPIF_INT_vect
+# define ADXRS_DMA_TRIGSRC  DMA_CH_TRIGSRC_SPIF_gc
 #endif
 
 #ifndef ADXRS_SPI_INT_vect
 # error No defined ADXRS_SPIx_ENABLE
 #endif
 
+#endif
 
-#define CALIBRATION_SAMPLES_LENGTH 101
+#ifdef ADXRS_SAMPLE_RING_SIZE
+# if ADXRS_SAMPLE_RING_SIZE & (ADXRS_SAMPLE_RING_SIZE-1) || ADXRS_SAMPLE_RING_SIZE > 256
+#  error ADXRS_SAMPLE_RING_SIZE must be a power of 2, not greater than 256
+# endif
+#endif
 
-/** @brief ADXRS gyro data
- *
- * The \e response field contains data of the last received response, i.e. the
- * response to the penultimate command.
- * It is updated by \ref adxrs_parse_response().
- */
-typedef struct {
-  portpin_t cspp;  ///< port pin of the inversed CS pin
-  adxrs_response_t response;  ///< response to the penultimate command
-  float angle;  ///< current angle for capture mode
-  float capture_scale;  ///< scaling coefficient for captured values
-  uint8_t capture_index;  ///< index of next captured byte
-  int16_t capture_speed;  ///< last (valid) captured angle speed
+#if defined(ADXRS_SAMPLE_RING_SIZE) || defined(ADXRS_CAPTURE_TIMESTAMP)
+# ifndef ADXRS_TIMESTAMP_TC
+#  error ADXRS_TIMESTAMP_TC must be defined to timestamp captured samples
+# endif
+# define ADXRS_USE_TIMESTAMP
+#endif
 
-  bool integrate; ///< if true adxrs module will integrate position over time
+#ifdef HOST_VERSION
+uint16_t adxrs_host_time;
+# define ADXRS_TIMESTAMP_CNT  adxrs_host_time
+#else
+# define ADXRS_TIMESTAMP_CNT  ADXRS_TIMESTAMP_TC.CNT
+#endif
 
-  struct {
-    bool mode;  ///< calibration mode
-    int16_t offset;  ///< calibration offset
-    float offset_sqsd; ///< calibration squared sd
+// Get DMA channels used for capture: RX on the configured one, TX on the next
+#ifdef ADXRS_CAPTURE_DMA_CH
+# if ADXRS_CAPTURE_DMA_CH == 0
+#  define ADXRS_DMA_RX  DMA.CH0
+#  define ADXRS_DMA_TX  DMA.CH1
+#  define ADXRS_DMA_RX_vect  DMA_CH0_vect
+# elif ADXRS_CAPTURE_DMA_CH == 1
+#  define ADXRS_DMA_RX  DMA.CH1
+#  define ADXRS_DMA_TX  DMA.CH2
+#  define ADXRS_DMA_RX_vect  DMA_CH1_vect
+# elif ADXRS_CAPTURE_DMA_CH == 2
+#  define ADXRS_DMA_RX  DMA.CH2
+#  define ADXRS_DMA_TX  DMA.CH3
+#  define ADXRS_DMA_RX_vect  DMA_CH2_vect
+# else
+#  error Invalid ADXRS_CAPTURE_DMA_CH value
+# endif
+#endif
 
-    float sum;
-    float sqsum;
-    fifo_t samples;
-    int16_t samples_buffer[CALIBRATION_SAMPLES_LENGTH];
-  } calibration;
-} adxrs_t;
 
+/// Maximum calibration sample deviation, keep squared sums within 32 bits
+#define CALIBRATION_DEVIATION_MAX 4095
+/// Maximum fractional bits of the angle accumulator
+#define ANGLE_SHIFT_MAX 47
+/// Maximum time between integrated samples, in timer ticks
+#define TIMESTAMP_DT_MAX 0x3fff
+/// Number of bias model points after which older points are forgotten
+#define BIAS_POINTS_MAX 32
+/// Minimum variance of raw temperatures to fit a bias slope
+#define BIAS_TEMPERATURE_VARIANCE_MIN 25
+
+/// Sensor data command sent in capture mode
+static const uint8_t capture_cmd_sensor_data[4] = { 0x20, 0x00, 0x00, 0x00 };
+#ifdef ADXRS_TEMPERATURE_PERIOD
+/// Temperature read command sent in capture mode
+static const uint8_t capture_cmd_read_tem[4] = { 0x80, ADXRS_REG_TEM << 1, 0x00, 0x01 };
+#endif
 
-/// The gyro
-static adxrs_t gyro;
 
+#ifdef ADXRS_CALIBRATION_EEPROM_SLOTS
 
-void adxrs_init(portpin_t cspp)
-{
-  gyro.cspp = cspp;
-  gyro.response.type = ADXRS_RESPONSE_NONE;
-  gyro.angle = 0;
-  gyro.calibration.mode = false;
-  gyro.calibration.offset = 0;
-  gyro.calibration.offset_sqsd = +INFINITY;
+/// Calibration record stored in EEPROM
+typedef struct {
+  uint32_t serial;  ///< gyro serial number, all bits set if unused
+  int16_t temperature;  ///< raw temperature when calibrated
+  int16_t offset;  ///< calibration offset
+  float variance;  ///< variance of calibration samples
+  uint16_t crc;  ///< CRC of previous fields
+} adxrs_calibration_record_t;
+
+/// Calibration records in EEPROM
+#define CALIBRATION_RECORDS \
+    ((adxrs_calibration_record_t *)(uintptr_t)ADXRS_CALIBRATION_EEPROM_ADDR)
+
+#endif
 
-  gyro.integrate = true;
 
-  fifo_init(&gyro.calibration.samples,
-    gyro.calibration.samples_buffer,
-    CALIBRATION_SAMPLES_LENGTH);
+/// Capture scheduler, shared by all gyros
+static struct {
+  adxrs_t *gyros[ADXRS_CAPTURE_MAX];  ///< captured gyros, in round-robin order
+  uint8_t count;  ///< number of captured gyros
+  uint8_t current;  ///< index of the gyro of the transfer in progress
+  adxrs_t *gyro;  ///< gyro of the transfer in progress
+  const uint8_t *cmd;  ///< command of the transfer in progress
+  uint8_t index;  ///< index of next captured byte
+} capture;
 
+
+void adxrs_init(adxrs_t *g, portpin_t cspp)
+{
+  g->cspp = cspp;
+  g->response.type = ADXRS_RESPONSE_NONE;
+  g->angle = 0;
+  g->angle_shift = ANGLE_SHIFT_MAX;
+  g->capture_scale = 0;
+  g->calibration.mode = false;
+  g->calibration.offset = 0;
+  g->calibration.sum = 0;
+  g->calibration.sqsum = 0;
+#ifdef ADXRS_SAMPLE_RING_SIZE
+  g->ring.head = g->ring.tail = 0;
+  g->ring.dropped = 0;
+#endif
+
+  g->capture_skip = false;
+  g->temperature = 0;
+#ifdef ADXRS_TEMPERATURE_PERIOD
+  g->bias.n = 0;
+#endif
+  g->integrate = true;
+  g->calibration.count = 0;
+  g->calibration.index = 0;
+#ifdef ADXRS_CALIBRATION_EEPROM_SLOTS
+  g->calibration.stored = false;
+#endif
+
+#ifndef HOST_VERSION
   // initialize SPI
   portpin_dirset(&PORTPIN_SPI_SS(&ADXRS_SPI));
   ADXRS_SPI.CTRL = SPI_ENABLE_bm | SPI_MASTER_bm | SPI_MODE_0_gc |
@@ -138,6 +231,7 @@ void adxrs_init(portpin_t cspp)
   portpin_dirset(&PORTPIN_SPI_MOSI(&ADXRS_SPI));
   portpin_dirclr(&PORTPIN_SPI_MISO(&ADXRS_SPI));
   portpin_dirset(&PORTPIN_SPI_SCK(&ADXRS_SPI));
+#endif
 
   portpin_dirset(&cspp);
   portpin_outset(&cspp);
@@ -160,11 +254,11 @@ static bool adxrs_check_response_parity(uint8_t data[4])
 }
 
 /// Parse command response
-static void adxrs_parse_response(uint8_t data[4])
+static void adxrs_parse_response(adxrs_t *g, uint8_t data[4])
 {
   // check parity
   if(!adxrs_check_response_parity(data)) {
-    gyro.response.type = ADXRS_RESPONSE_BAD_PARITY;
+    g->response.type = ADXRS_RESPONSE_BAD_PARITY;
     return;
   }
 
@@ -174,31 +268,31 @@ static void adxrs_parse_response(uint8_t data[4])
     uint8_t type = (data[0] >> 5) & 0x7;
     if(type == 0) {
       // R/W error
-      gyro.response.type = ADXRS_RESPONSE_RW_ERROR;
-      gyro.response.rw_error.spi_error = (data[1] >> 2) & 1;
-      gyro.response.rw_error.request_error = (data[1] >> 1) & 1;
-      gyro.response.rw_error.data_unavailable = data[1] & 1;
+      g->response.type = ADXRS_RESPONSE_RW_ERROR;
+      g->response.rw_error.spi_error = (data[1] >> 2) & 1;
+      g->response.rw_error.request_error = (data[1] >> 1) & 1;
+      g->response.rw_error.data_unavailable = data[1] & 1;
     } else {
       // read/write
       if(type == 1) {
-        gyro.response.type = ADXRS_RESPONSE_WRITE;
+        g->response.type = ADXRS_RESPONSE_WRITE;
       } else if(type == 2) {
-        gyro.response.type = ADXRS_RESPONSE_READ;
+        g->response.type = ADXRS_RESPONSE_READ;
       } else {
         // unknown type
-        gyro.response.type = ADXRS_RESPONSE_INVALID;
+        g->response.type = ADXRS_RESPONSE_INVALID;
       }
-      gyro.response.read.data = ((uint16_t)(data[1] & 0x1f) << 11) |
+      g->response.read.data = ((uint16_t)(data[1] & 0x1f) << 11) |
           ((uint16_t)data[2] << 3) | (data[3] >> 5);
     }
   } else {
     // sensor data
-    gyro.response.type = ADXRS_RESPONSE_SENSOR_DATA;
-    gyro.response.sensor_data.sequence = (data[0] >> 5) & 0x7;
-    gyro.response.sensor_data.status = status;
-    gyro.response.sensor_data.data = ((uint16_t)(data[0] & 0x03) << 14) |
+    g->response.type = ADXRS_RESPONSE_SENSOR_DATA;
+    g->response.sensor_data.sequence = (data[0] >> 5) & 0x7;
+    g->response.sensor_data.status = status;
+    g->response.sensor_data.data = ((uint16_t)(data[0] & 0x03) << 14) |
         ((uint16_t)data[1] << 6) | (data[2] >> 2);
-    gyro.response.sensor_data.fault_raw = data[3] & 0xfe;
+    g->response.sensor_data.fault_raw = data[3] & 0xfe;
   }
 }
 
@@ -206,280 +300,840 @@ static void adxrs_parse_response(uint8_t data[4])
 /// Send and receive a single byte to/from SPI
 static uint8_t adxrs_spi_transmit(uint8_t data)
 {
+#ifdef HOST_VERSION
+  return adxrs_host_spi_transfer(data);
+#else
   ADXRS_SPI.DATA = data;
   while(!(ADXRS_SPI.STATUS & SPI_IF_bm)) ;
   return ADXRS_SPI.DATA;
+#endif
 }
 
 
-void adxrs_cmd_raw(uint8_t data[4])
+void adxrs_cmd_raw(adxrs_t *g, uint8_t data[4])
 {
   // send/receive data
-  portpin_outclr(&gyro.cspp);
+  portpin_outclr(&g->cspp);
   uint8_t rdata[4];
   rdata[0] = adxrs_spi_transmit(data[0]);
   rdata[1] = adxrs_spi_transmit(data[1]);
   rdata[2] = adxrs_spi_transmit(data[2]);
   rdata[3] = adxrs_spi_transmit(data[3]);
-  portpin_outset(&gyro.cspp);
-  adxrs_parse_response(rdata);
+  portpin_outset(&g->cspp);
+  adxrs_parse_response(g, rdata);
 }
 
-void adxrs_cmd_sensor_data(uint8_t seq, bool chk)
+void adxrs_cmd_sensor_data(adxrs_t *g, uint8_t seq, bool chk)
 {
   uint8_t p = (seq >> 1) ^ (seq >> 1) ^ seq ^ chk;
   uint8_t data[4] = { ((seq & 3) << 6) | 0x20 | ((seq & 7) << 2),
     0, 0, p | (chk << 1) };
-  adxrs_cmd_raw(data);
+  adxrs_cmd_raw(g, data);
 }
 
-void adxrs_cmd_read(uint8_t addr)
+void adxrs_cmd_read(adxrs_t *g, uint8_t addr)
 {
   uint8_t p = parity_even_bit(addr);
   uint8_t data[4] = { 0x80 | ((addr >> 7) & 0x1), addr << 1, 0, p };
-  adxrs_cmd_raw(data);
+  adxrs_cmd_raw(g, data);
 }
 
-void adxrs_cmd_write(uint8_t addr, uint16_t value)
+void adxrs_cmd_write(adxrs_t *g, uint8_t addr, uint16_t value)
 {
   uint8_t p = parity_even_bit(addr ^ (uint8_t)value ^ (uint8_t)(value >> 8));
   uint8_t data[4] = { 0x40 | addr >> 7, (addr << 1) | ((value >> 15) & 0x1),
     value >> 7, ((uint8_t)value << 1) | p };
-  adxrs_cmd_raw(data);
+  adxrs_cmd_raw(g, data);
+}
+
+adxrs_response_t const *adxrs_get_response(adxrs_t *g)
+{
+  return &g->response;
+}
+
+
+#ifdef ADXRS_CALIBRATION_EEPROM_SLOTS
+
+/// Read a 16-bit register in polling mode, return true on success
+static bool adxrs_read_register(adxrs_t *g, uint8_t addr, uint16_t *value)
+{
+  adxrs_cmd_read(g, addr);
+  adxrs_cmd_read(g, addr);
+  if(g->response.type != ADXRS_RESPONSE_READ) {
+    return false;
+  }
+  *value = g->response.read.data;
+  return true;
+}
+
+/// Compute the CRC of a calibration record
+static uint16_t adxrs_calibration_crc(const adxrs_calibration_record_t *rec)
+{
+  uint16_t crc = 0xffff;
+  for(uint8_t i=0; i<offsetof(adxrs_calibration_record_t, crc); i++) {
+    crc = _crc_ccitt_update(crc, ((const uint8_t*)rec)[i]);
+  }
+  return crc;
 }
 
-adxrs_response_t const *adxrs_get_response(void)
+/** @brief Find the EEPROM record of a serial number, or a free one
+ * @return The record index, \e ADXRS_CALIBRATION_EEPROM_SLOTS if not found.
+ */
+static uint8_t adxrs_calibration_find(uint32_t serial, bool free)
 {
-  return &gyro.response;
+  uint8_t i;
+  for(i=0; i<ADXRS_CALIBRATION_EEPROM_SLOTS; i++) {
+    uint32_t v;
+    eeprom_read_block(&v, &CALIBRATION_RECORDS[i].serial, sizeof(v));
+    if(v == serial || (free && v == 0xffffffff)) {
+      break;
+    }
+  }
+  return i;
+}
+
+/** @brief Read gyro serial number and temperature, load stored calibration
+ *
+ * Stored calibration is used only if temperature did not changed too much.
+ */
+static void adxrs_calibration_load(adxrs_t *g)
+{
+  g->calibration.stored = false;
+  uint16_t sn3, sn1, tem;
+  if(!adxrs_read_register(g, ADXRS_REG_SN3, &sn3) ||
+     !adxrs_read_register(g, ADXRS_REG_SN1, &sn1) ||
+     !adxrs_read_register(g, ADXRS_REG_TEM, &tem)) {
+    return;
+  }
+  g->serial = ((uint32_t)sn3 << 16) | sn1;
+  g->temperature = (int16_t)tem >> 6;
+
+  uint8_t slot = adxrs_calibration_find(g->serial, false);
+  if(slot == ADXRS_CALIBRATION_EEPROM_SLOTS) {
+    return;
+  }
+  adxrs_calibration_record_t rec;
+  eeprom_read_block(&rec, &CALIBRATION_RECORDS[slot], sizeof(rec));
+  if(rec.crc != adxrs_calibration_crc(&rec)) {
+    return;
+  }
+  if(abs(rec.temperature - g->temperature) >
+     ADXRS_CALIBRATION_TEMPERATURE_TOLERANCE * ADXRS_TEMPERATURE_SCALE) {
+    return;
+  }
+  g->calibration.offset = rec.offset;
+  g->calibration.stored_variance = rec.variance;
+  g->calibration.stored = true;
 }
 
+#endif
 
-bool adxrs_startup(void)
+bool adxrs_startup(adxrs_t *g)
 {
   _delay_ms(100);
-  adxrs_cmd_sensor_data(0, 1);
+  adxrs_cmd_sensor_data(g, 0, 1);
   _delay_ms(50);
-  adxrs_cmd_sensor_data(0, 0);
+  adxrs_cmd_sensor_data(g, 0, 0);
   _delay_ms(50);
-  adxrs_cmd_sensor_data(0, 0);
-  if(gyro.response.type != ADXRS_RESPONSE_SENSOR_DATA
-     || gyro.response.sensor_data.status != 2
-     || gyro.response.sensor_data.fault_raw != 0xfe) {
+  adxrs_cmd_sensor_data(g, 0, 0);
+  if(g->response.type != ADXRS_RESPONSE_SENSOR_DATA
+     || g->response.sensor_data.status != 2
+     || g->response.sensor_data.fault_raw != 0xfe) {
     return false;
   }
 
   _delay_ms(50);
-  adxrs_cmd_sensor_data(0, 0);
-  if(gyro.response.type != ADXRS_RESPONSE_SENSOR_DATA
-     || gyro.response.sensor_data.status != 2
-     || gyro.response.sensor_data.fault_raw != 0xfe) {
+  adxrs_cmd_sensor_data(g, 0, 0);
+  if(g->response.type != ADXRS_RESPONSE_SENSOR_DATA
+     || g->response.sensor_data.status != 2
+     || g->response.sensor_data.fault_raw != 0xfe) {
     return false;
   }
 
   _delay_ms(50);
-  adxrs_cmd_sensor_data(0, 0);
-  if(gyro.response.type != ADXRS_RESPONSE_SENSOR_DATA
-     || gyro.response.sensor_data.status != 1
-     || gyro.response.sensor_data.fault_raw != 0) {
+  adxrs_cmd_sensor_data(g, 0, 0);
+  if(g->response.type != ADXRS_RESPONSE_SENSOR_DATA
+     || g->response.sensor_data.status != 1
+     || g->response.sensor_data.fault_raw != 0) {
     return false;
   }
 
+#ifdef ADXRS_CALIBRATION_EEPROM_SLOTS
+  adxrs_calibration_load(g);
+#endif
+
   return true;
 }
 
 
-void adxrs_capture_start(float scale)
+/** @brief Set the capture scale
+ *
+ * Scale is stored as a 16-bit value with the same fixed point as the angle.
+ * If it does not fit, angle precision is lowered.
+ */
+static void adxrs_set_capture_scale(adxrs_t *g, float scale)
 {
-  gyro.angle = 0;
-  gyro.capture_scale = scale;
-  gyro.capture_index = 0;
-  gyro.capture_speed = 0;
+#ifdef ADXRS_CAPTURE_TIMESTAMP
+  // trapezoidal rule sums two speeds
+  scale /= 2;
+#endif
+  int exp;
+  frexpf(scale, &exp);
+  // |scale| < 2^exp, thus |scale| * 2^(15-exp) < 2^15
+  int8_t shift = 15 - exp;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    if(shift < g->angle_shift) {
+      g->angle >>= g->angle_shift - shift;
+      g->angle_shift = shift;
+    }
+    int32_t v = lrintf(ldexpf(scale, g->angle_shift));
+    // rounding may reach 2^15
+    g->capture_scale = v > INT16_MAX ? INT16_MAX : v < -INT16_MAX ? -INT16_MAX : v;
+  }
+}
 
-  // Send a sensor data command to be sure that the first response received by
-  // the interrupt handler is a sensor data response with an up-to-date value.
-  portpin_outclr(&gyro.cspp);
-  adxrs_spi_transmit(0x20);
-  adxrs_spi_transmit(0x00);
-  adxrs_spi_transmit(0x00);
-  adxrs_spi_transmit(0x00);
-  portpin_outset(&gyro.cspp);
+/// Return the mean of calibration samples, must be called with interrupts disabled
+static int16_t adxrs_calibration_mean(adxrs_t *g)
+{
+  int16_t n = g->calibration.count;
+  if(n == 0) {
+    return g->calibration.offset;
+  }
+  int32_t sum = g->calibration.sum;
+  // round to nearest
+  sum += sum < 0 ? -n/2 : n/2;
+  return g->calibration.ref + sum / n;
+}
 
+#ifdef ADXRS_CAPTURE_DMA_CH
+
+/// Response bytes received by DMA during capture
+static volatile uint8_t adxrs_dma_data[4];
+
+/// Set a DMA channel address register from a data pointer
+static void adxrs_dma_set_addr(register8_t *reg, const volatile void *p)
+{
+  uint16_t addr = (uintptr_t)p;
+  reg[0] = addr & 0xff;
+  reg[1] = addr >> 8;
+  reg[2] = 0;
+}
+
+/// Prepare DMA channels for the next command, its first byte is sent by the CPU
+static void adxrs_dma_arm(const uint8_t *cmd)
+{
+  ADXRS_DMA_RX.TRFCNT = 4;
+  ADXRS_DMA_RX.CTRLA = DMA_CH_ENABLE_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+  adxrs_dma_set_addr(&ADXRS_DMA_TX.SRCADDR0, cmd + 1);
+  ADXRS_DMA_TX.TRFCNT = 3;
+  ADXRS_DMA_TX.CTRLA = DMA_CH_ENABLE_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+}
+
+#endif
+
+/// Enable capture interrupts and start the first command
+static void adxrs_capture_run(void)
+{
+#ifdef ADXRS_CAPTURE_DMA_CH
+  // Both channels are triggered by SPI transfer completion: RX stores the
+  // received byte, TX sends the next command byte.
+  // SPI reception is double buffered, so RX/TX ordering does not matter.
+  DMA.CTRL |= DMA_ENABLE_bm;
+  ADXRS_DMA_RX.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_FIXED_gc |
+      DMA_CH_DESTRELOAD_TRANSACTION_gc | DMA_CH_DESTDIR_INC_gc;
+  ADXRS_DMA_RX.TRIGSRC = ADXRS_DMA_TRIGSRC;
+  adxrs_dma_set_addr(&ADXRS_DMA_RX.SRCADDR0, &ADXRS_SPI.DATA);
+  adxrs_dma_set_addr(&ADXRS_DMA_RX.DESTADDR0, adxrs_dma_data);
+  ADXRS_DMA_RX.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm |
+      (ADXRS_CAPTURE_INTLVL << DMA_CH_TRNINTLVL_gp);
+  ADXRS_DMA_TX.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_INC_gc |
+      DMA_CH_DESTRELOAD_NONE_gc | DMA_CH_DESTDIR_FIXED_gc;
+  ADXRS_DMA_TX.TRIGSRC = ADXRS_DMA_TRIGSRC;
+  adxrs_dma_set_addr(&ADXRS_DMA_TX.DESTADDR0, &ADXRS_SPI.DATA);
+  ADXRS_DMA_TX.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
+  adxrs_dma_arm(capture_cmd_sensor_data);
+#elif !defined(HOST_VERSION)
   // Enable interruptions and start the capture with the first command byte
   ADXRS_SPI.INTCTRL = ADXRS_CAPTURE_INTLVL;
+#endif
+  capture.current = 0;
+  capture.gyro = capture.gyros[0];
+  capture.cmd = capture_cmd_sensor_data;
+  capture.index = 0;
   // /CS must be high for 100ns, or 3.2 cycles at 32MHz (max frequency)
   // add some nops juste to be sure
   _NOP(); _NOP(); _NOP();
-  portpin_outclr(&gyro.cspp);
-  ADXRS_SPI.DATA = 0x20;
+  portpin_outclr(&capture.gyro->cspp);
+#ifndef HOST_VERSION
+  ADXRS_SPI.DATA = capture.cmd[0];
+#endif
 }
 
-void adxrs_capture_stop(void)
+/// Select the gyro and the command of the next capture transfer
+static void adxrs_capture_next(void)
 {
-  ADXRS_SPI.INTCTRL = 0;
-  gyro.response.type = ADXRS_RESPONSE_NONE;
-  portpin_outset(&gyro.cspp);
+  if(++capture.current >= capture.count) {
+    capture.current = 0;
+  }
+  adxrs_t *g = capture.gyros[capture.current];
+  capture.gyro = g;
+#ifdef ADXRS_TEMPERATURE_PERIOD
+  if(--g->bias.countdown == 0) {
+    g->bias.countdown = ADXRS_TEMPERATURE_PERIOD;
+    capture.cmd = capture_cmd_read_tem;
+    return;
+  }
+#endif
+  capture.cmd = capture_cmd_sensor_data;
+}
+
+bool adxrs_capture_start(adxrs_t *g, float scale)
+{
+  bool ret = true;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    g->angle = 0;
+    g->angle_shift = ANGLE_SHIFT_MAX;
+    adxrs_set_capture_scale(g, scale);
+    g->capture_speed = 0;
+    // The first response received by the interrupt handler answers a command
+    // sent before the capture, it is ignored.
+    g->capture_skip = true;
+#ifdef ADXRS_CAPTURE_TIMESTAMP
+    g->capture_first = true;
+#endif
+#ifdef ADXRS_TEMPERATURE_PERIOD
+    g->bias.countdown = ADXRS_TEMPERATURE_PERIOD;
+#endif
+
+    uint8_t i;
+    for(i=0; i<capture.count; i++) {
+      if(capture.gyros[i] == g) {
+        break;
+      }
+    }
+    if(i < capture.count) {
+      // already captured
+    } else if(capture.count == ADXRS_CAPTURE_MAX) {
+      ret = false;
+    } else {
+      capture.gyros[capture.count++] = g;
+      if(capture.count == 1) {
+        adxrs_capture_run();
+      }
+    }
+  }
+  return ret;
 }
 
-void adxrs_calibration_mode(bool activate)
+void adxrs_capture_stop(adxrs_t *g)
 {
-  gyro.calibration.mode = activate;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    // remove the gyro, keeping others in order
+    uint8_t i = capture.count;
+    uint8_t n = 0;
+    for(uint8_t j=0; j<capture.count; j++) {
+      if(capture.gyros[j] == g) {
+        i = j;
+      } else {
+        capture.gyros[n++] = capture.gyros[j];
+      }
+    }
+    if(i < capture.count) {
+      capture.count = n;
+      if(capture.count == 0) {
+        // last captured gyro, abort the transfer in progress
+#ifdef ADXRS_CAPTURE_DMA_CH
+        ADXRS_DMA_RX.CTRLA = 0;
+        ADXRS_DMA_TX.CTRLA = 0;
+        ADXRS_DMA_RX.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm;
+#elif !defined(HOST_VERSION)
+        ADXRS_SPI.INTCTRL = 0;
+#endif
+        portpin_outset(&capture.gyro->cspp);
+      } else if(i <= capture.current) {
+        // keep the next gyro in the round-robin order
+        capture.current = (capture.current == 0 ? capture.count : capture.current) - 1;
+      }
+    }
+  }
+  g->response.type = ADXRS_RESPONSE_NONE;
 }
 
-void adxrs_integrate(bool activate)
+#ifdef ADXRS_TEMPERATURE_PERIOD
+
+/// Evaluate the bias model at a given temperature
+static int16_t adxrs_bias_model(adxrs_t *g, int16_t temperature)
 {
-  gyro.integrate = activate;
+  int32_t dt = temperature - g->bias.t0;
+  return g->bias.b0 + g->bias.intercept + (int16_t)(((int32_t)g->bias.slope * dt) >> 8);
 }
 
-bool adxrs_get_calibration_mode()
+/// Handle a new temperature value, update offset from the bias model
+static void adxrs_temperature_update(adxrs_t *g, uint16_t tem)
 {
-  return gyro.calibration.mode;
+  g->temperature = (int16_t)tem >> 6;
+  if(!g->calibration.mode && g->bias.n > 0) {
+    g->calibration.offset = adxrs_bias_model(g, g->temperature);
+  }
 }
 
-float adxrs_get_angle(void)
+/** @brief Add a calibration result to the bias model
+ *
+ * Bias is fitted linearly against temperature, using least squares.
+ * Values are stored relative to the first point to keep sums small.
+ * Older points are progressively forgotten.
+ */
+static void adxrs_bias_add_point(adxrs_t *g, int16_t temperature, int16_t offset)
 {
-  float angle;
+  if(g->bias.n == 0) {
+    g->bias.t0 = temperature;
+    g->bias.b0 = offset;
+    g->bias.sx = g->bias.sy = g->bias.sxx = g->bias.sxy = 0;
+  } else if(g->bias.n == BIAS_POINTS_MAX) {
+    g->bias.n /= 2;
+    g->bias.sx /= 2;
+    g->bias.sy /= 2;
+    g->bias.sxx /= 2;
+    g->bias.sxy /= 2;
+  }
+  int16_t x = temperature - g->bias.t0;
+  int16_t y = offset - g->bias.b0;
+  uint8_t n = g->bias.n + 1;
+  int32_t sx = g->bias.sx + x;
+  int32_t sy = g->bias.sy + y;
+  int32_t sxx = g->bias.sxx + (int32_t)x*x;
+  int32_t sxy = g->bias.sxy + (int32_t)x*y;
+
+  // slope is fitted only if temperatures are spread enough
+  int32_t slope = 0;
+  int64_t den = (int64_t)n*sxx - (int64_t)sx*sx;
+  if(den >= (int32_t)BIAS_TEMPERATURE_VARIANCE_MIN*n*n) {
+    slope = (((int64_t)n*sxy - (int64_t)sx*sy) << 8) / den;
+    if(slope > INT16_MAX) {
+      slope = INT16_MAX;
+    } else if(slope < -INT16_MAX) {
+      slope = -INT16_MAX;
+    }
+  }
+  int16_t intercept = (sy - ((slope * sx) >> 8)) / n;
+
   INTLVL_DISABLE_ALL_BLOCK() {
-    angle = gyro.angle;
+    g->bias.n = n;
+    g->bias.sx = sx;
+    g->bias.sy = sy;
+    g->bias.sxx = sxx;
+    g->bias.sxy = sxy;
+    g->bias.slope = slope;
+    g->bias.intercept = intercept;
   }
-  return angle;
 }
 
-void adxrs_set_angle(float angle)
+#endif
+
+void adxrs_calibration_mode(adxrs_t *g, bool activate)
 {
+#ifdef ADXRS_TEMPERATURE_PERIOD
+  bool done = !activate && g->calibration.mode;
+#endif
   INTLVL_DISABLE_ALL_BLOCK() {
-    gyro.angle = angle;
+    if(activate && !g->calibration.mode) {
+      // restart calibration, next sample will be used as reference
+      g->calibration.count = 0;
+      g->calibration.index = 0;
+      g->calibration.sum = 0;
+      g->calibration.sqsum = 0;
+    } else if(!activate && g->calibration.mode) {
+      g->calibration.offset = adxrs_calibration_mean(g);
+#ifdef ADXRS_CALIBRATION_EEPROM_SLOTS
+      g->calibration.stored = false;
+#endif
+    }
+    g->calibration.mode = activate;
   }
+#ifdef ADXRS_TEMPERATURE_PERIOD
+  if(done) {
+    adxrs_bias_add_point(g, g->temperature, g->calibration.offset);
+  }
+#endif
 }
 
-float adxrs_get_speed(void) {
+void adxrs_integrate(adxrs_t *g, bool activate)
+{
+  g->integrate = activate;
+}
+
+bool adxrs_get_calibration_mode(adxrs_t *g)
+{
+  return g->calibration.mode;
+}
+
+float adxrs_get_angle(adxrs_t *g)
+{
+  int64_t angle;
+  int8_t shift;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    angle = g->angle;
+    shift = g->angle_shift;
+  }
+  return ldexpf(angle, -shift);
+}
+
+void adxrs_set_angle(adxrs_t *g, float angle)
+{
+  INTLVL_DISABLE_ALL_BLOCK() {
+    g->angle = ldexpf(angle, g->angle_shift);
+  }
+}
+
+float adxrs_get_speed(adxrs_t *g) {
   float speed;
   INTLVL_DISABLE_ALL_BLOCK() {
-    speed = gyro.capture_speed;
+    speed = g->capture_speed;
   }
   return speed;
 }
 
-int16_t adxrs_get_offset() {
+int16_t adxrs_get_offset(adxrs_t *g) {
   int16_t offset;
   INTLVL_DISABLE_ALL_BLOCK() {
-    offset = gyro.calibration.offset;
+    offset = g->calibration.mode ? adxrs_calibration_mean(g) : g->calibration.offset;
   }
   return offset;
 }
 
-float adxrs_get_offset_sqsd() {
-  float sqsd;
+int16_t adxrs_get_temperature(adxrs_t *g) {
+  int16_t temperature;
   INTLVL_DISABLE_ALL_BLOCK() {
-    sqsd = gyro.calibration.offset_sqsd;
+    temperature = g->temperature;
   }
-  return sqsd;
+  return temperature;
 }
 
-// Update captured angle value
-static void adxrs_update_angle(uint8_t data[4])
+float adxrs_get_offset_sqsd(adxrs_t *g) {
+  int16_t n;
+  int32_t sum, sqsum;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    n = g->calibration.count;
+    sum = g->calibration.sum;
+    sqsum = g->calibration.sqsum;
+  }
+  if(n < 2) {
+    return +INFINITY;
+  }
+  return ((float)n*sqsum - (float)sum*sum) / ((float)n*n);
+}
+
+#ifdef ADXRS_CALIBRATION_EEPROM_SLOTS
+
+bool adxrs_calibration_save(adxrs_t *g)
 {
-  if(adxrs_check_response_parity(data) && (data[0] & 0x0C) == 0x04) {
-    // valid response, parse speed
-    gyro.capture_speed = ((uint16_t)(data[0] & 0x03) << 14) |
-        ((uint16_t)data[1] << 6) | (data[2] >> 2);
+  adxrs_calibration_record_t rec;
+  rec.variance = adxrs_get_offset_sqsd(g);
+  if(isinf(rec.variance)) {
+    return false;
+  }
+  rec.serial = g->serial;
+  rec.temperature = g->temperature;
+  rec.offset = adxrs_get_offset(g);
+  rec.crc = adxrs_calibration_crc(&rec);
+
+  uint8_t slot = adxrs_calibration_find(g->serial, true);
+  if(slot == ADXRS_CALIBRATION_EEPROM_SLOTS) {
+    return false;
+  }
+  eeprom_update_block(&rec, &CALIBRATION_RECORDS[slot], sizeof(rec));
+  return true;
+}
+
+bool adxrs_calibration_confirm(adxrs_t *g)
+{
+  uint8_t n;
+  int16_t delta;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    n = g->calibration.count;
+    delta = adxrs_calibration_mean(g) - g->calibration.offset;
+  }
+  if(!g->calibration.stored || !g->calibration.mode ||
+     n < ADXRS_CALIBRATION_CONFIRM_SAMPLES) {
+    return false;
+  }
+  // mean of the short window must be within 3 standard errors of the stored
+  // offset, plus the rounding of both values
+  float bound = 3 * sqrtf(g->calibration.stored_variance / n) + 1;
+  if(abs(delta) > bound) {
+    return false;
   }
-  else
+  // keep the stored offset
+  g->calibration.mode = false;
+  return true;
+}
+
+#endif
+
+#ifdef ADXRS_SAMPLE_RING_SIZE
+
+// Push a captured sample to the ring
+static void adxrs_sample_push(adxrs_t *g, uint8_t data[4], bool parity, uint16_t time)
+{
+  uint8_t head = g->ring.head;
+  uint8_t next = (head + 1) & (ADXRS_SAMPLE_RING_SIZE - 1);
+  if(next == g->ring.tail) {
+    g->ring.dropped++;
     return;
+  }
+  volatile adxrs_sample_t *sample = &g->ring.samples[head];
+  sample->time = time;
+  sample->rate = ((uint16_t)(data[0] & 0x03) << 14) |
+      ((uint16_t)data[1] << 6) | (data[2] >> 2);
+  sample->status = ((data[0] >> 2) & 0x3) | (parity ? 0 : ADXRS_SAMPLE_BAD_PARITY);
+  g->ring.head = next;
+}
 
-  // check calibration signal rising edge
-  static bool lcalibration = false;
-  if(gyro.calibration.mode && !lcalibration) {
-    gyro.calibration.offset = gyro.capture_speed;
+uint8_t adxrs_samples_read(adxrs_t *g, adxrs_sample_t *samples, uint8_t n)
+{
+  uint8_t tail = g->ring.tail;
+  uint8_t i;
+  for(i=0; i<n && tail != g->ring.head; i++) {
+    samples[i] = g->ring.samples[tail];
+    tail = (tail + 1) & (ADXRS_SAMPLE_RING_SIZE - 1);
   }
-  lcalibration = gyro.calibration.mode;
+  g->ring.tail = tail;
+  return i;
+}
 
-  if(gyro.calibration.mode) {
+uint16_t adxrs_samples_dropped(adxrs_t *g)
+{
+  uint16_t dropped;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    dropped = g->ring.dropped;
+    g->ring.dropped = 0;
+  }
+  return dropped;
+}
 
-    // update sum
-    float v = gyro.capture_speed;
-    if(fifo_isfull(&gyro.calibration.samples)) {
-      float ov = fifo_pop(&gyro.calibration.samples);
-      gyro.calibration.sum -= ov;
-      gyro.calibration.sqsum -= ov*ov;
-    }
-    gyro.calibration.sum += v;
-    gyro.calibration.sqsum += v*v;
-    fifo_push(&gyro.calibration.samples, v);
+#endif
 
-    // compute mean value and mean of squared values
-    int n = fifo_size(&gyro.calibration.samples);
-    float mean = gyro.calibration.sum/n;
-    float sqmean = gyro.calibration.sqsum/n;
+#ifdef ADXRS_CAPTURE_TIMESTAMP
+
+/// Multiply a 32-bit value by a 16-bit value, without a full 64-bit multiply
+static inline int64_t adxrs_mul_32_16(int32_t a, int16_t b)
+{
+  int32_t hi = (int32_t)(int16_t)(a >> 16) * b;
+  int32_t lo = (int32_t)(uint16_t)a * b;
+  return ((int64_t)hi << 16) + lo;
+}
 
-    // compute squared standard dev of measure
-    float sqsd = 1.0*(n*sqmean - mean*mean)/(n*n);
+#endif
 
-    // update gyro offset
-    gyro.calibration.offset = mean;
-    gyro.calibration.offset_sqsd = sqsd;
+/// Integrate an angle change, if enabled
+static void adxrs_add_angle(adxrs_t *g, int64_t delta)
+{
+  if(g->integrate) {
+    int64_t angle = g->angle + delta;
+    INTLVL_DISABLE_ALL_BLOCK() {
+      g->angle = angle;
+    }
   }
   else {
-    // update angle (internal) value
-    // on error, previous (valid) speed value is used
-    gyro.capture_speed = gyro.capture_speed - gyro.calibration.offset;
-    if(gyro.integrate) {
-      float angle = gyro.angle + gyro.capture_speed * gyro.capture_scale;
-      INTLVL_DISABLE_ALL_BLOCK() {
-        gyro.angle = angle;
-      }
+    // nothing to do
+  }
+}
+
+// Update captured angle value
+static void adxrs_update_angle(adxrs_t *g, uint8_t data[4])
+{
+#ifdef ADXRS_USE_TIMESTAMP
+  uint16_t time = ADXRS_TIMESTAMP_CNT;
+#endif
+  bool parity = adxrs_check_response_parity(data);
+#ifdef ADXRS_SAMPLE_RING_SIZE
+  adxrs_sample_push(g, data, parity, time);
+#endif
+  if(!parity) {
+    return;
+  }
+#ifdef ADXRS_TEMPERATURE_PERIOD
+  if((data[0] & 0xEC) == 0x4C) {
+    // read response, for the temperature register
+    adxrs_temperature_update(g, ((uint16_t)(data[1] & 0x1f) << 11) |
+                             ((uint16_t)data[2] << 3) | (data[3] >> 5));
+# ifndef ADXRS_CAPTURE_TIMESTAMP
+    // no speed for this capture period, use the previous one
+    if(!g->calibration.mode) {
+      adxrs_add_angle(g, (int32_t)g->capture_speed * g->capture_scale);
+    }
+# endif
+    return;
+  }
+#endif
+  if((data[0] & 0x0C) != 0x04) {
+    return;
+  }
+  // valid response, parse speed
+  int16_t speed = ((uint16_t)(data[0] & 0x03) << 14) |
+      ((uint16_t)data[1] << 6) | (data[2] >> 2);
+
+  if(g->calibration.mode) {
+    g->capture_speed = speed;
+#ifdef ADXRS_CAPTURE_TIMESTAMP
+    g->capture_first = true;
+#endif
+    // the first sample is used as reference, to keep sums small
+    if(g->calibration.count == 0) {
+      g->calibration.ref = speed;
+    }
+    int16_t v = speed - g->calibration.ref;
+    if(v > CALIBRATION_DEVIATION_MAX) {
+      v = CALIBRATION_DEVIATION_MAX;
+    } else if(v < -CALIBRATION_DEVIATION_MAX) {
+      v = -CALIBRATION_DEVIATION_MAX;
+    }
+
+    // update sums, mean and variance are computed on demand
+    if(g->calibration.count == ADXRS_CALIBRATION_SAMPLES) {
+      int16_t ov = g->calibration.samples[g->calibration.index];
+      g->calibration.sum -= ov;
+      g->calibration.sqsum -= (int32_t)ov*ov;
+    } else {
+      g->calibration.count++;
+    }
+    g->calibration.sum += v;
+    g->calibration.sqsum += (int32_t)v*v;
+    g->calibration.samples[g->calibration.index] = v;
+    if(++g->calibration.index == ADXRS_CALIBRATION_SAMPLES) {
+      g->calibration.index = 0;
     }
-    else {
-      // nothing to do
+  }
+  else {
+    // update angle (internal) value
+    // on error, the sample is skipped
+    speed -= g->calibration.offset;
+#ifdef ADXRS_CAPTURE_TIMESTAMP
+    // trapezoidal rule, using time since the previous valid sample
+    uint16_t dt = time - g->capture_time;
+    if(dt > TIMESTAMP_DT_MAX) {
+      dt = TIMESTAMP_DT_MAX;
     }
+    int32_t area = g->capture_first ? 0 : ((int32_t)speed + g->capture_speed) * dt;
+    g->capture_time = time;
+    g->capture_first = false;
+    int64_t delta = adxrs_mul_32_16(area, g->capture_scale);
+#else
+    int32_t delta = (int32_t)speed * g->capture_scale;
+#endif
+    g->capture_speed = speed;
+    adxrs_add_angle(g, delta);
   }
 }
 
 
-void adxrs_capture_manual(float scale)
+void adxrs_capture_manual(adxrs_t *g, float scale)
 {
   // send next capture command
   uint8_t rdata[4];
-  portpin_outclr(&gyro.cspp);
+  portpin_outclr(&g->cspp);
   rdata[0] = adxrs_spi_transmit(0x20);
   rdata[1] = adxrs_spi_transmit(0x00);
   rdata[2] = adxrs_spi_transmit(0x00);
   rdata[3] = adxrs_spi_transmit(0x00);
-  portpin_outset(&gyro.cspp);
+  portpin_outset(&g->cspp);
 
   if(scale != 0) {
     // check response, update angle
-    gyro.capture_scale = scale;
-    adxrs_update_angle(rdata);
+    adxrs_set_capture_scale(g, scale);
+    adxrs_update_angle(g, rdata);
   } else {
     // reset current speed
-    gyro.capture_speed = 0;
+    g->capture_speed = 0;
+#ifdef ADXRS_CAPTURE_TIMESTAMP
+    g->capture_first = true;
+#endif
+  }
+}
+
+
+/// Process a response received in capture mode
+static void adxrs_capture_process(adxrs_t *g, uint8_t data[4])
+{
+  if(g->capture_skip) {
+    g->capture_skip = false;
+  } else {
+    adxrs_update_angle(g, data);
+  }
+}
+
+
+#if defined(HOST_VERSION)
+
+adxrs_t *adxrs_host_capture(void)
+{
+  adxrs_t *g;
+  uint8_t data[4];
+  INTLVL_DISABLE_ALL_BLOCK() {
+    if(capture.count == 0) {
+      return NULL;
+    }
+    g = capture.gyro;
+    for(uint8_t i=0; i<4; i++) {
+      data[i] = adxrs_spi_transmit(capture.cmd[i]);
+    }
+    adxrs_capture_next();
   }
+  adxrs_capture_process(g, data);
+  return g;
 }
 
+#elif defined(ADXRS_CAPTURE_DMA_CH)
+
+/// Interrupt handler for capture mode, called once per command
+ISR(ADXRS_DMA_RX_vect)
+{
+  ADXRS_DMA_RX.CTRLB = DMA_CH_TRNIF_bm | DMA_CH_ERRIF_bm |
+      (ADXRS_CAPTURE_INTLVL << DMA_CH_TRNINTLVL_gp);
+  adxrs_t *g = capture.gyro;
+  portpin_outset(&g->cspp);
+  uint8_t data[4] = {
+    adxrs_dma_data[0], adxrs_dma_data[1], adxrs_dma_data[2], adxrs_dma_data[3],
+  };
+
+  // rearm DMA and send the first byte of a new command, to the next gyro
+  // copying the data above keeps /CS high long enough
+  adxrs_capture_next();
+  adxrs_dma_arm(capture.cmd);
+  portpin_outclr(&capture.gyro->cspp);
+  ADXRS_SPI.DATA = capture.cmd[0];
+
+  // check response, update angle while the next command is transferred
+  adxrs_capture_process(g, data);
+}
+
+#else
 
 /// Interrupt handler for capture mode
 ISR(ADXRS_SPI_INT_vect)
 {
   static uint8_t data[4];  // current capture data
 
-  // command sent is always the same: 0x20000000
-  // only the first byte has a not-null value, this is convenient
-  data[gyro.capture_index] = ADXRS_SPI.DATA;
-  if(++gyro.capture_index == 4) {
-    portpin_outset(&gyro.cspp);
+  data[capture.index] = ADXRS_SPI.DATA;
+  if(++capture.index == 4) {
+    adxrs_t *g = capture.gyro;
+    portpin_outset(&g->cspp);
 
     // check response, update angle
-    adxrs_update_angle(data);
+    adxrs_capture_process(g, data);
 
-    // first byte of a new command
-    portpin_outclr(&gyro.cspp);
-    gyro.capture_index = 0;
-    ADXRS_SPI.DATA = 0x20;
+    // first byte of a new command, to the next gyro
+    adxrs_capture_next();
+    portpin_outclr(&capture.gyro->cspp);
+    capture.index = 0;
+    ADXRS_SPI.DATA = capture.cmd[0];
   } else {
     // the command continue
-    ADXRS_SPI.DATA = 0x00;
+    ADXRS_SPI.DATA = capture.cmd[capture.index];
   }
 }
 
+#endif
+
 
 ///@endcond
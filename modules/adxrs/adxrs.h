@@ -1,7 +1,8 @@
 /** @defgroup adxrs ADXRS gyro
  * @brief Analog Devices' ADXRS453 gyro
  *
- * This module handles a single gyro.
+ * This module handles several gyros sharing the same SPI bus, with a
+ * different CS pin for each gyro.
  * There are two operation modes: polling mode and capture mode. One can switch
  * from one mode to the other but only methods of the currently active mode can
  * be used.
@@ -13,6 +14,7 @@
  * In capture mode, sensor data commands are sent repeatedly using SPI
  * interrupt. Angle speed is retrieved and integrated; the angle position
  * value can be retrieved with \ref adxrs_get_angle().
+ * When several gyros are captured, commands are sent to each of them in turn.
  * A manual capture mode is available; capture are not interrupt-based but
  * triggered manually.
  *
@@ -31,10 +33,19 @@
 #ifndef ADXRS_H
 #define ADXRS_H
 
-#include <avr/io.h>
 #include <stdint.h>
 #include <stdbool.h>
-#include <avarix/portpin.h>
+#ifdef HOST_VERSION
+// no ports on host, CS pins are not driven
+typedef struct {
+  void *port;
+  uint8_t pin;
+} portpin_t;
+#else
+# include <avr/io.h>
+# include <avarix/portpin.h>
+#endif
+#include "adxrs_config.h"
 
 
 /// ADXRS response type
@@ -112,16 +123,112 @@ typedef union {
 
 
 
-/** @brief Initialize the gyro
+/** @brief Captured sample
+ *
+ * Samples are stored by the capture handler if \e ADXRS_SAMPLE_RING_SIZE is
+ * defined.
+ */
+typedef struct {
+  uint16_t time;  ///< \e ADXRS_TIMESTAMP_TC counter value at capture
+  int16_t rate;  ///< raw rate value, without offset correction
+  uint8_t status;  ///< status bits (ST), \ref ADXRS_SAMPLE_BAD_PARITY on error
+} adxrs_sample_t;
+
+/// Flag set in sample status on bad response parity
+#define ADXRS_SAMPLE_BAD_PARITY  0x80
+
+
+/// Number of samples used for calibration
+#define ADXRS_CALIBRATION_SAMPLES  100
+
+
+/** @brief ADXRS gyro data
+ *
+ * The \e response field contains data of the last received response, i.e. the
+ * response to the penultimate command.
+ *
+ * @note Fields are private and should not be accessed directly.
+ */
+typedef struct {
+  portpin_t cspp;  ///< port pin of the inversed CS pin
+  adxrs_response_t response;  ///< response to the penultimate command
+  int64_t angle;  ///< current angle for capture mode, fixed point
+  int8_t angle_shift;  ///< number of fractional bits of angle
+  int16_t capture_scale;  ///< scaling coefficient, same fixed point as angle
+  int16_t capture_speed;  ///< last (valid) captured angle speed
+  bool capture_skip;  ///< true to ignore the next captured response
+#if defined(ADXRS_CAPTURE_TIMESTAMP) || DOXYGEN
+  uint16_t capture_time;  ///< timestamp of the last integrated sample
+  bool capture_first;  ///< true if the next sample starts integration
+#endif
+
+  bool integrate; ///< if true adxrs module will integrate position over time
+
+  struct {
+    bool mode;  ///< calibration mode
+    int16_t offset;  ///< calibration offset
+
+    int16_t ref;  ///< reference value of samples (first calibration sample)
+    int32_t sum;  ///< sum of sample deviations from ref
+    int32_t sqsum;  ///< sum of squared sample deviations from ref
+    uint8_t count;  ///< number of samples
+    uint8_t index;  ///< index of the oldest sample, next one to replace
+    int16_t samples[ADXRS_CALIBRATION_SAMPLES];  ///< sample deviations from ref
+#if defined(ADXRS_CALIBRATION_EEPROM_SLOTS) || DOXYGEN
+    bool stored;  ///< true if offset has been loaded from EEPROM
+    float stored_variance;  ///< variance of the loaded calibration
+#endif
+  } calibration;
+
+#if defined(ADXRS_CALIBRATION_EEPROM_SLOTS) || DOXYGEN
+  uint32_t serial;  ///< gyro serial number
+#endif
+  int16_t temperature;  ///< last read raw temperature
+
+#if defined(ADXRS_TEMPERATURE_PERIOD) || DOXYGEN
+  /** @brief Bias model, linear against temperature
+   *
+   * Values are relative to the first point (\e t0, \e b0).
+   */
+  struct {
+    uint16_t countdown;  ///< capture commands before next temperature read
+    int16_t t0;  ///< temperature of the first point
+    int16_t b0;  ///< offset of the first point
+    uint8_t n;  ///< number of points
+    int32_t sx, sy, sxx, sxy;  ///< least squares sums
+    int16_t intercept;  ///< offset at t0, relative to b0
+    int16_t slope;  ///< offset change per raw temperature unit, Q8
+  } bias;
+#endif
+
+#if defined(ADXRS_SAMPLE_RING_SIZE) || DOXYGEN
+  /** @brief Captured samples
+   *
+   * Samples are pushed by the capture handler and popped by the user.
+   * The last sample before the tail is always free.
+   */
+  struct {
+    adxrs_sample_t samples[ADXRS_SAMPLE_RING_SIZE];
+    uint8_t head;  ///< index of the next sample to push
+    uint8_t tail;  ///< index of the next sample to pop
+    uint16_t dropped;  ///< number of samples dropped because ring was full
+  } volatile ring;
+#endif
+} adxrs_t;
+
+
+/** @brief Initialize a gyro
  *
+ * @param g  gyro to initialize
  * @param cspp  port pin of the CS pin
  */
-void adxrs_init(portpin_t cspp);
+void adxrs_init(adxrs_t *g, portpin_t cspp);
 
 
 /** @name Polling mode methods
  *
- * These method must not be used whil capture mode is active.
+ * These method must not be used whil capture mode is active, for any gyro
+ * of the bus.
  */
 //@{
 
@@ -131,39 +238,39 @@ void adxrs_init(portpin_t cspp);
  *
  * @note Parity bit is not modified.
  */
-void adxrs_cmd_raw(uint8_t data[4]);
+void adxrs_cmd_raw(adxrs_t *g, uint8_t data[4]);
 
 /** @brief Send a sensor data command
  *
  * @param seq  sequence bits (SQ)
  * @param chk  CHK bit
  */
-void adxrs_cmd_sensor_data(uint8_t seq, bool chk);
+void adxrs_cmd_sensor_data(adxrs_t *g, uint8_t seq, bool chk);
 
 /** @brief Send a read command
  *
  * @param addr  register address to read
  */
-void adxrs_cmd_read(uint8_t addr);
+void adxrs_cmd_read(adxrs_t *g, uint8_t addr);
 
 /** @brief Send a write command
  *
  * @param addr  register address to write
  * @param value  new register value
  */
-void adxrs_cmd_write(uint8_t addr, uint16_t value);
+void adxrs_cmd_write(adxrs_t *g, uint8_t addr, uint16_t value);
 
 /** @brief Return the reponse to the penultimate command
  * @note Response is not updated while in capture mode.
  */
-adxrs_response_t const *adxrs_get_response(void);
+adxrs_response_t const *adxrs_get_response(adxrs_t *g);
 
 /** @brief Send a start-up sequence
  *
  * Execute the recommended start-up sequence with CHK bit assertion.
  * Return true on success, false on error (unexpected reply).
  */
-bool adxrs_startup(void);
+bool adxrs_startup(adxrs_t *g);
 
 //@}
 
@@ -173,7 +280,11 @@ bool adxrs_startup(void);
  * In capture mode, gyro angle speed is continuously polled and integrated
  * using SPI interruption.
  * Current angle value can be retrieved at any moment.
- * Capture period is determined by SPI period.
+ * Capture period is determined by SPI period and the number of captured
+ * gyros.
+ *
+ * If \e ADXRS_CAPTURE_DMA_CH is defined, command bytes are transferred using
+ * the DMA controller and only one interrupt is triggered per sample.
  *
  * An alternate mode not using interruptions is available. Values are retrieved
  * manually using \ref adxrs_capture_manual().
@@ -190,54 +301,178 @@ bool adxrs_startup(void);
  * gyro values to milliradians.
  *
  * Current angle value is reset to 0.
+ *
+ * Return false if \e ADXRS_CAPTURE_MAX gyros are already captured.
+ *
+ * If \e ADXRS_CAPTURE_TIMESTAMP is defined, \a scale applies to a single
+ * \e ADXRS_TIMESTAMP_TC tick instead of a capture period.
+ *
+ * Angle is integrated in fixed point. \a scale is converted to a 16-bit
+ * value, its relative precision is better than 2^-14.
  */
-void adxrs_capture_start(float scale);
+bool adxrs_capture_start(adxrs_t *g, float scale);
 
-/// Stop capture mode
-void adxrs_capture_stop(void);
+/** @brief Stop capture mode
+ *
+ * Capture interrupts are disabled when the last captured gyro is stopped.
+ */
+void adxrs_capture_stop(adxrs_t *g);
 
 /** @brief Manually capture the next angle value
  *
  * \a scale is the value for the current capture and should be based on the
  * time since the previous capture.
+ * If \e ADXRS_CAPTURE_TIMESTAMP is defined, the time is measured and \a scale
+ * is the same as for \ref adxrs_capture_start().
  *
  * If scale is 0, captured valued is not used. It should be used to initialize
  * the capture.
  */
-void adxrs_capture_manual(float scale);
+void adxrs_capture_manual(adxrs_t *g, float scale);
 
 /** @brief activate ADXRS calibration mode
  * @param activate if TRUE activate calibration mode
  */
-void adxrs_calibration_mode(bool activate);
+void adxrs_calibration_mode(adxrs_t *g, bool activate);
 
 /** @brief if TRUE adxrs will integrate speed over time,
  * if FALSE it will not and angle will not change
  */
-void adxrs_integrate(bool activate);
+void adxrs_integrate(adxrs_t *g, bool activate);
 
 /** @brief Return TRUE if calibration is active, FALSE otherwise
  */
-bool adxrs_get_calibration_mode(void);
+bool adxrs_get_calibration_mode(adxrs_t *g);
 
 /// Get current angle value
-float adxrs_get_angle(void);
+float adxrs_get_angle(adxrs_t *g);
 
 /// Set current angle value
-void adxrs_set_angle(float angle);
+void adxrs_set_angle(adxrs_t *g, float angle);
 
 /// Get current measured angular speed
-float adxrs_get_speed(void);
+float adxrs_get_speed(adxrs_t *g);
 
-/// Get current gyro offset
-int16_t adxrs_get_offset(void);
+/** @brief Get current gyro offset
+ *
+ * If \e ADXRS_TEMPERATURE_PERIOD is defined, the offset follows the gyro
+ * temperature, using a bias model fitted on calibration results.
+ */
+int16_t adxrs_get_offset(adxrs_t *g);
 
-/// Get current gyro offset sqsd
-float adxrs_get_offset_sqsd(void);
+/** @brief Get last read raw temperature
+ *
+ * Temperature is read by \ref adxrs_startup() if calibration storage is
+ * enabled, and during capture if \e ADXRS_TEMPERATURE_PERIOD is defined.
+ *
+ * Temperature in Celsius is
+ * <tt>raw / ADXRS_TEMPERATURE_SCALE + ADXRS_TEMPERATURE_OFFSET</tt>.
+ */
+int16_t adxrs_get_temperature(adxrs_t *g);
+
+#if defined(ADXRS_SAMPLE_RING_SIZE) || DOXYGEN
+
+/** @brief Pop captured samples
+ *
+ * Samples are popped from the oldest to the newest.
+ * This method must not be called concurrently, but does not block the
+ * capture handler.
+ *
+ * @param samples  buffer to fill
+ * @param n  maximum number of samples to pop
+ *
+ * @return The number of popped samples.
+ */
+uint8_t adxrs_samples_read(adxrs_t *g, adxrs_sample_t *samples, uint8_t n);
+
+/// Get and reset the number of samples dropped because the ring was full
+uint16_t adxrs_samples_dropped(adxrs_t *g);
+
+#endif
+
+/** @brief Get variance of calibration samples
+ *
+ * Return +INFINITY if there is not enough calibration samples.
+ */
+float adxrs_get_offset_sqsd(adxrs_t *g);
 
 //@}
 
 
+#if defined(ADXRS_CALIBRATION_EEPROM_SLOTS) || DOXYGEN
+
+/** @name Calibration storage
+ *
+ * Calibration offsets can be saved in EEPROM, one record per gyro, identified
+ * by its serial number.
+ * The stored record is loaded by \ref adxrs_startup() if the current gyro
+ * temperature is close to the temperature it has been saved with.
+ *
+ * Typical use:
+ * @code
+ * adxrs_capture_start(&gyro, scale);
+ * adxrs_calibration_mode(&gyro, true);
+ * // wait for ADXRS_CALIBRATION_CONFIRM_SAMPLES samples
+ * if(!adxrs_calibration_confirm(&gyro)) {
+ *   // wait for a full calibration
+ *   adxrs_calibration_mode(&gyro, false);
+ *   adxrs_calibration_save(&gyro);
+ * }
+ * @endcode
+ */
+//@{
+
+/** @brief Save current calibration to EEPROM
+ *
+ * Temperature is the last read one, see \ref adxrs_get_temperature().
+ * Return false if there is not enough calibration samples or if there is no
+ * free EEPROM record.
+ */
+bool adxrs_calibration_save(adxrs_t *g);
+
+/** @brief Confirm the stored calibration
+ *
+ * Check that the mean of calibration samples matches the offset loaded from
+ * EEPROM. If it does, calibration mode is left and the loaded offset is used.
+ *
+ * Return false if calibration mode is not active, if no calibration has been
+ * loaded, if there is not enough samples yet, or if the offset does not match.
+ */
+bool adxrs_calibration_confirm(adxrs_t *g);
+
+//@}
+
+#endif
+
+
+#if defined(HOST_VERSION) || DOXYGEN
+
+/** @name Host interface
+ *
+ * On host, there is no SPI nor interrupts. SPI transfers are delegated to the
+ * application and capture transfers are run manually, one at a time.
+ * See \ref adxrs_replay.h for a ready-made implementation.
+ */
+//@{
+
+/// Transfer a single byte on SPI, provided by the application
+uint8_t adxrs_host_spi_transfer(uint8_t data);
+
+/// Value of the timestamp timer, used in place of \ref ADXRS_TIMESTAMP_TC
+extern uint16_t adxrs_host_time;
+
+/** @brief Run a capture transfer, in place of the capture interrupt handler
+ *
+ * @return the gyro whose response has been processed, NULL if no gyro is
+ * captured.
+ */
+adxrs_t *adxrs_host_capture(void);
+
+//@}
+
+#endif
+
+
 /** @name Memory register map */
 //@{
 
@@ -271,6 +506,11 @@ float adxrs_get_offset_sqsd(void);
 #define ADXRS_REG_PID  ADXRS_REG_PID1
 #define ADXRS_REG_SN  ADXRS_REG_SN3
 
+/// Scale of raw temperature values (LSB per degree Celsius)
+#define ADXRS_TEMPERATURE_SCALE  5
+/// Temperature for a null raw temperature value, in degrees Celsius
+#define ADXRS_TEMPERATURE_OFFSET  45
+
 //@}
 
 
@@ -0,0 +1,144 @@
+/**
+ * @cond internal
+ * @file
+ */
+#include "adxrs.h"
+// Replay is only available on host
+#ifdef HOST_VERSION
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "adxrs_replay.h"
+
+
+/// Replay state
+static struct {
+  uint8_t data[4];  ///< response of the replayed transfer
+  uint8_t index;  ///< index of the next transferred byte
+} replay;
+
+adxrs_replay_stats_t adxrs_replay_stats;
+
+
+uint8_t adxrs_host_spi_transfer(uint8_t data)
+{
+  (void)data;  // sent commands are not checked
+  return replay.data[replay.index++ & 3];
+}
+
+
+/// Return true if response parity is valid
+static bool adxrs_replay_check_parity(const uint8_t data[4])
+{
+  uint8_t parity = data[0] ^ data[1];
+  if(!__builtin_parity(parity)) {
+    return false;
+  }
+  parity ^= data[2] ^ data[3];
+  return __builtin_parity(parity);
+}
+
+/// Return monotonic host time, in nanoseconds
+static uint64_t adxrs_replay_time_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+void adxrs_replay_reset_stats(void)
+{
+  memset(&adxrs_replay_stats, 0, sizeof(adxrs_replay_stats));
+}
+
+adxrs_t *adxrs_replay_transfer(uint16_t time, const uint8_t data[4])
+{
+  memcpy(replay.data, data, sizeof(replay.data));
+  replay.index = 0;
+  adxrs_host_time = time;
+
+  uint64_t t0 = adxrs_replay_time_ns();
+  adxrs_t *g = adxrs_host_capture();
+  adxrs_replay_stats.process_ns += adxrs_replay_time_ns() - t0;
+
+  if(g) {
+    adxrs_replay_stats.transfers++;
+    if(!adxrs_replay_check_parity(data)) {
+      adxrs_replay_stats.bad_parity++;
+    }
+  }
+  return g;
+}
+
+int32_t adxrs_replay_run(FILE *fp, uint32_t n)
+{
+  char line[128];
+  uint32_t count = 0;
+  while((n == 0 || count < n) && fgets(line, sizeof(line), fp)) {
+    unsigned int time;
+    unsigned long response;
+    double angle;
+    int ret = sscanf(line, "%u %8lx %lf", &time, &response, &angle);
+    if(ret < 0 || line[0] == '#') {
+      continue;  // empty line or comment
+    } else if(ret < 2) {
+      return -1;
+    }
+    uint8_t data[4] = {
+      response >> 24, response >> 16, response >> 8, response,
+    };
+    adxrs_t *g = adxrs_replay_transfer(time, data);
+    if(!g) {
+      return count;
+    }
+    count++;
+
+    if(ret == 3) {
+      adxrs_replay_stats_t *st = &adxrs_replay_stats;
+      double error = adxrs_get_angle(g) - angle;
+      st->truth_count++;
+      st->error_sqsum += error * error;
+      st->error_last = error;
+      if(fabs(error) > st->error_max) {
+        st->error_max = fabs(error);
+      }
+    }
+  }
+  return count;
+}
+
+void adxrs_replay_encode(int16_t rate, uint8_t data[4])
+{
+  uint16_t v = rate;
+  data[0] = 0x04 | ((v >> 14) & 0x03);
+  data[1] = v >> 6;
+  data[2] = (v << 2) & 0xfc;
+  data[3] = 0;
+  // parity must be odd
+  if(!__builtin_parity(data[0] ^ data[1])) {
+    data[0] |= 0x10;
+  }
+  if(!__builtin_parity(data[0] ^ data[1] ^ data[2] ^ data[3])) {
+    data[3] |= 0x01;
+  }
+}
+
+void adxrs_replay_print_stats(FILE *fp, const char *name)
+{
+  const adxrs_replay_stats_t *st = &adxrs_replay_stats;
+  fprintf(fp, "%s: %u transfers, %u bad parity",
+          name, st->transfers, st->bad_parity);
+  if(st->truth_count) {
+    fprintf(fp, ", angle error: last %+g, max %g, rms %g",
+            st->error_last, st->error_max, sqrt(st->error_sqsum / st->truth_count));
+  }
+  if(st->transfers) {
+    fprintf(fp, ", %.1f ns/transfer", (double)st->process_ns / st->transfers);
+  }
+  fprintf(fp, "\n");
+}
+
+#endif
+///@endcond
@@ -0,0 +1,89 @@
+/** @addtogroup adxrs */
+//@{
+/** @file
+ * @brief ADXRS capture replay (host only)
+ */
+/** @name Capture replay
+ *
+ * Recorded gyro responses are fed to the capture processing path, in place of
+ * the SPI bus. This allows to evaluate integration accuracy and handling of
+ * transmission errors against a ground truth, without hardware.
+ *
+ * Traces are text files with one capture transfer per line:
+ * @verbatim <time> <response> [<angle>] @endverbatim
+ *  - \e time: timestamp timer value, in ticks
+ *  - \e response: the 4 received bytes, as 8 hexadecimal digits
+ *  - \e angle: ground truth angle after the transfer, optional
+ *
+ * Empty lines and lines starting with '#' are ignored.
+ *
+ * As on the target, the first response after \ref adxrs_capture_start()
+ * answers a command sent before the capture and is ignored. When several gyros
+ * are captured, transfers are dispatched to them in round-robin order.
+ *
+ * The \e tools/adxrs_replay host program replays a trace file and prints
+ * statistics. It comes with a small synthetic trace and its generator.
+ */
+//@{
+#ifndef ADXRS_REPLAY_H__
+#define ADXRS_REPLAY_H__
+
+#ifndef HOST_VERSION
+# error ADXRS capture replay is only available on host
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include "adxrs.h"
+
+/// Replay statistics
+typedef struct {
+  uint32_t transfers;  ///< number of replayed transfers
+  uint32_t bad_parity;  ///< responses with a parity error
+  uint32_t truth_count;  ///< number of ground truth angles
+  double error_max;  ///< maximum absolute angle error
+  double error_sqsum;  ///< sum of squared angle errors
+  double error_last;  ///< angle error at the last ground truth
+  uint64_t process_ns;  ///< host time spent processing transfers
+
+} adxrs_replay_stats_t;
+
+/// Statistics of the replay
+extern adxrs_replay_stats_t adxrs_replay_stats;
+
+
+/// Reset replay statistics
+void adxrs_replay_reset_stats(void);
+
+/** @brief Replay a single capture transfer
+ *
+ * @param time  timestamp timer value
+ * @param data  received bytes
+ *
+ * @return the gyro whose response has been processed, NULL if no gyro is
+ * captured.
+ */
+adxrs_t *adxrs_replay_transfer(uint16_t time, const uint8_t data[4]);
+
+/** @brief Replay transfers from a trace file
+ *
+ * @param fp  trace file
+ * @param n  maximum number of transfers to replay, 0 for no limit
+ *
+ * @return the number of replayed transfers, -1 on invalid line.
+ */
+int32_t adxrs_replay_run(FILE *fp, uint32_t n);
+
+/** @brief Encode a sensor data response
+ *
+ * Status bits are set to valid data and parity bits are set.
+ * This allows to build synthetic traces.
+ */
+void adxrs_replay_encode(int16_t rate, uint8_t data[4]);
+
+/// Print replay statistics: parity errors, angle error, processing time
+void adxrs_replay_print_stats(FILE *fp, const char *name);
+
+#endif
+//@}
+//@}
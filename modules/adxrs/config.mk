@@ -1,2 +1,7 @@
-SRCS = adxrs.c
+SRCS = adxrs.c adxrs_replay.c
+# clock is only used on AVR
+ifeq ($(HOST),avr)
 MODULES = clock
+else
+MODULES =
+endif
@@ -173,14 +173,15 @@ uint8_t ax12_write_word(ax12_t *s, uint8_t id, ax12_addr_t addr, uint16_t data)
   return ax12_recv(s, &pkt);
 }
 
-uint8_t ax12_write_mem(ax12_t *s, uint8_t id, ax12_addr_t addr, uint8_t n, const uint8_t *data)
+/// Send a WRITE or REG_WRITE instruction, wait for the reply
+static uint8_t ax12_write_instr(ax12_t *s, uint8_t instr, uint8_t id, ax12_addr_t addr, uint8_t n, const uint8_t *data)
 {
   if(n >= AX12_MAX_PARAMS) {
     return AX12_ERROR_INVALID_PACKET;
   }
   ax12_pkt_t pkt = {
     .id = id,
-    .instruction = AX12_INSTR_WRITE,
+    .instruction = instr,
     .nparams = n+1,
     .params = { addr },
   };
@@ -199,80 +200,205 @@ uint8_t ax12_write_mem(ax12_t *s, uint8_t id, ax12_addr_t addr, uint8_t n, const
   return ax12_recv(s, &pkt);
 }
 
+uint8_t ax12_write_mem(ax12_t *s, uint8_t id, ax12_addr_t addr, uint8_t n, const uint8_t *data)
+{
+  return ax12_write_instr(s, AX12_INSTR_WRITE, id, addr, n, data);
+}
+
+uint8_t ax12_reg_write_mem(ax12_t *s, uint8_t id, ax12_addr_t addr, uint8_t n, const uint8_t *data)
+{
+  return ax12_write_instr(s, AX12_INSTR_REG_WRITE, id, addr, n, data);
+}
+
 uint8_t ax12_read_byte(ax12_t *s, uint8_t id, ax12_addr_t addr, uint8_t *data)
 {
-  ax12_pkt_t pkt = {
-    .id = id,
-    .instruction = AX12_INSTR_READ,
-    .nparams = 2,
-    .params = { addr, 1 },
-  };
+  return ax12_read_mem(s, id, addr, 1, data);
+}
 
+uint8_t ax12_read_word(ax12_t *s, uint8_t id, ax12_addr_t addr, uint16_t *data)
+{
+  uint8_t buf[2];
   uint8_t ret;
-  if((ret = ax12_send(s, &pkt))) {
+  if((ret = ax12_read_mem(s, id, addr, sizeof(buf), buf))) {
     return ret;
   }
-  if((ret = ax12_recv(s, &pkt))) {
-    return ret;
-  }
-
-  *data = pkt.params[0];
+  *data = buf[0] | (buf[1] << 8);
   return 0;
 }
 
-uint8_t ax12_read_word(ax12_t *s, uint8_t id, ax12_addr_t addr, uint16_t *data)
+static int8_t ax12_send_bytes(ax12_t *s, const uint8_t *data, uint8_t n, uint8_t *checksum);
+
+uint8_t ax12_read_mem(ax12_t *s, uint8_t id, ax12_addr_t addr, uint8_t n, uint8_t *data)
 {
-  ax12_pkt_t pkt = {
-    .id = id,
-    .instruction = AX12_INSTR_READ,
-    .nparams = 2,
-    .params = { addr, 2 },
-  };
+  if(n == 0 || n > 0xFF - 2 || id == AX12_BROADCAST_ID) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
 
-  uint8_t ret;
-  if((ret = ax12_send(s, &pkt))) {
-    return ret;
+  // send the READ instruction, without building a packet
+  s->set_state(AX12_STATE_WRITE);
+  uint8_t checksum = 0;
+  const uint8_t header[] = { id, 4, AX12_INSTR_READ, addr, n };
+  if(s->send(0xFF) || s->send(0xFF)) {
+    goto fail;
   }
-  if((ret = ax12_recv(s, &pkt))) {
-    return ret;
+  if(ax12_send_bytes(s, header, sizeof(header), &checksum)) {
+    goto fail;
+  }
+  // lock before sending the last byte, see ax12_send()
+  INTLVL_DISABLE_ALL_BLOCK() {
+    if(s->send(~checksum)) {
+      goto fail;
+    }
+    s->set_state(AX12_STATE_READ);
   }
 
-  *data = pkt.params[0] | (pkt.params[1] << 8);
+  // receive the reply, parameters are written directly to data
+  int c;
+  c = s->recv();
+  if(c == -1) {
+    return AX12_ERROR_NO_REPLY;
+  } else if(c != 0xFF) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  c = s->recv();
+  if(c == -1) {
+    return AX12_ERROR_REPLY_TIMEOUT;
+  } else if(c != 0xFF) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+
+  // ID, length, error
+  uint8_t status[3];
+  for(uint8_t i=0; i<sizeof(status); i++) {
+    c = s->recv();
+    if(c == -1) {
+      return AX12_ERROR_REPLY_TIMEOUT;
+    }
+    status[i] = c;
+  }
+  if(status[0] != id) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  // servo errors may be reported without parameters
+  if(status[2] && (status[1] == 2 || status[1] == n + 2)) {
+    return status[2];
+  }
+  if(status[1] != n + 2) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  checksum = status[0] + status[1];
+
+  // parameters
+  for(uint8_t i=0; i<n; i++) {
+    c = s->recv();
+    if(c == -1) {
+      return AX12_ERROR_REPLY_TIMEOUT;
+    }
+    data[i] = c;
+    checksum += c;
+  }
+
+  // checksum
+  c = s->recv();
+  if(c != (uint8_t)~checksum) {
+    return AX12_ERROR_BAD_CHECKSUM;
+  }
+
+  return 0;
+
+ fail:
+  s->set_state(AX12_STATE_READ);
+  return AX12_ERROR_SEND_FAILED;
+}
+
+
+/// Send bytes, update the checksum, return non-zero on error
+static int8_t ax12_send_bytes(ax12_t *s, const uint8_t *data, uint8_t n, uint8_t *checksum)
+{
+  for(uint8_t i=0; i<n; i++) {
+    if(s->send(data[i])) {
+      return -1;
+    }
+    *checksum += data[i];
+  }
   return 0;
 }
 
-uint8_t ax12_read_mem(ax12_t *s, uint8_t id, ax12_addr_t addr, uint8_t n, uint8_t *data)
+uint8_t ax12_sync_write(ax12_t *s, ax12_addr_t addr, uint8_t len, uint8_t n,
+                        const uint8_t ids[], const uint8_t data[])
 {
-  if(n >= AX12_MAX_PARAMS) {
+  // length field: instruction, address, length, parameters, checksum
+  const uint16_t pkt_len = (uint16_t)n * (len + 1) + 4;
+  if(n == 0 || len == 0 || pkt_len > 0xFF) {
     return AX12_ERROR_INVALID_PACKET;
   }
+
+  // switch line to write
+  s->set_state(AX12_STATE_WRITE);
+
+  // packet is streamed, parameters don't fit in an ax12_pkt_t
+  uint8_t checksum = 0;
+  const uint8_t header[] = {
+    AX12_BROADCAST_ID, pkt_len,
+    AX12_INSTR_SYNC_WRITE, addr, len,
+  };
+  if(s->send(0xFF) || s->send(0xFF)) {
+    goto fail;
+  }
+  if(ax12_send_bytes(s, header, sizeof(header), &checksum)) {
+    goto fail;
+  }
+  for(uint8_t i=0; i<n; i++) {
+    if(ax12_send_bytes(s, &ids[i], 1, &checksum)) {
+      goto fail;
+    }
+    if(ax12_send_bytes(s, data, len, &checksum)) {
+      goto fail;
+    }
+    data += len;
+  }
+
+  // no reply on broadcast, lock anyway to behave like ax12_send()
+  INTLVL_DISABLE_ALL_BLOCK() {
+    if(s->send(~checksum)) {
+      goto fail;
+    }
+    s->set_state(AX12_STATE_READ);
+  }
+
+  return 0;
+
+ fail:
+  s->set_state(AX12_STATE_READ);
+  return AX12_ERROR_SEND_FAILED;
+}
+
+
+uint8_t ax12_ping(ax12_t *s, uint8_t id)
+{
   ax12_pkt_t pkt = {
     .id = id,
-    .instruction = AX12_INSTR_READ,
-    .nparams = 2,
-    .params = { addr, n },
+    .instruction = AX12_INSTR_PING,
+    .nparams = 0,
+    .params = {},
   };
 
   uint8_t ret;
   if((ret = ax12_send(s, &pkt))) {
     return ret;
   }
-  if((ret = ax12_recv(s, &pkt))) {
-    return ret;
+  if(pkt.id == AX12_BROADCAST_ID) {
+    return 0;  // no reply on broadcast
   }
 
-  for(uint8_t i=0; i<n; i++) {
-    data[i] = pkt.params[0];
-  }
-  return 0;
+  return ax12_recv(s, &pkt);
 }
 
-
-uint8_t ax12_ping(ax12_t *s, uint8_t id)
+uint8_t ax12_action(ax12_t *s, uint8_t id)
 {
   ax12_pkt_t pkt = {
     .id = id,
-    .instruction = AX12_INSTR_PING,
+    .instruction = AX12_INSTR_ACTION,
     .nparams = 0,
     .params = {},
   };
@@ -288,6 +414,63 @@ uint8_t ax12_ping(ax12_t *s, uint8_t id)
   return ax12_recv(s, &pkt);
 }
 
+
+bool ax12_group_init(ax12_group_t *group, uint8_t n, const uint8_t *ids)
+{
+  group->staged = 0;
+  group->ids = ids;
+  if(n > AX12_GROUP_MAX_SIZE) {
+    group->n = 0;
+    return false;
+  }
+  group->n = n;
+  return true;
+}
+
+uint8_t ax12_group_stage_one(ax12_t *s, ax12_group_t *group, uint8_t i,
+                             ax12_addr_t addr, uint8_t len, const uint8_t *data)
+{
+  if(i >= group->n) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  const uint16_t bit = (uint16_t)1 << i;
+  group->staged &= ~bit;
+  uint8_t ret = ax12_reg_write_mem(s, group->ids[i], addr, len, data);
+  if(ret == 0) {
+    group->staged |= bit;
+  }
+  return ret;
+}
+
+uint8_t ax12_group_stage(ax12_t *s, ax12_group_t *group,
+                         ax12_addr_t addr, uint8_t len, const uint8_t *data)
+{
+  uint8_t err = 0;
+  for(uint8_t i=0; i<group->n; i++) {
+    uint8_t ret = ax12_group_stage_one(s, group, i, addr, len, data);
+    if(ret && !err) {
+      err = ret;
+    }
+    data += len;
+  }
+  return err;
+}
+
+bool ax12_group_ready(const ax12_group_t *group)
+{
+  return group->staged == (uint16_t)((1UL << group->n) - 1);
+}
+
+uint8_t ax12_group_action(ax12_t *s, ax12_group_t *group)
+{
+  uint8_t ret = ax12_action(s, AX12_BROADCAST_ID);
+  if(ret == 0) {
+    group->staged = 0;
+  }
+  return ret;
+}
+
+
 uint8_t ax12_reset(ax12_t *s, uint8_t id)
 {
   ax12_pkt_t pkt = {
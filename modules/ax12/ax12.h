@@ -13,6 +13,7 @@
 #define AX12_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "address.h"
 #include "ax12_config.h"
 
@@ -95,6 +96,12 @@ typedef struct {
   int (*recv)(void);
   /// Switch UART line state
   void (*set_state)(ax12_state_t);
+  /** @brief Callback to receive a byte without blocking
+   *
+   * Return the received byte or -1 if none is available.
+   * Only required by asynchronous transactions (see ax12_async.h).
+   */
+  int (*recv_nowait)(void);
 
 } ax12_t;
 
@@ -120,25 +127,112 @@ uint8_t ax12_write_word(ax12_t *s, uint8_t id, ax12_addr_t addr, uint16_t data);
 /// Write n bytes to AX-12 memory
 uint8_t ax12_write_mem(ax12_t *s, uint8_t id, ax12_addr_t addr, uint8_t n, const uint8_t *data);
 
+/** @brief Register a write of n bytes to AX-12 memory
+ *
+ * The write is performed on the next ACTION instruction.
+ *
+ * @sa ax12_action()
+ */
+uint8_t ax12_reg_write_mem(ax12_t *s, uint8_t id, ax12_addr_t addr, uint8_t n, const uint8_t *data);
+
 /// Read a byte from AX-12 memory
 uint8_t ax12_read_byte(ax12_t *s, uint8_t id, ax12_addr_t addr, uint8_t *data);
 
 /// Read a word (2 bytes) from AX-12 memory
 uint8_t ax12_read_word(ax12_t *s, uint8_t id, ax12_addr_t addr, uint16_t *data);
 
-/// Read n bytes from AX-12 memory
+/** @brief Read n bytes from AX-12 memory
+ *
+ * Data is received directly in the provided buffer, without intermediate
+ * packet. It is not limited by \ref AX12_MAX_PARAMS.
+ *
+ * @note On error, \e data may have been partially modified.
+ */
 uint8_t ax12_read_mem(ax12_t *s, uint8_t id, ax12_addr_t addr, uint8_t n, uint8_t *data);
 
+/** @brief Write the same memory range of several AX-12 in a single packet
+ *
+ * A broadcast SYNC_WRITE packet is sent; AX-12 don't reply.
+ *
+ * @param addr  address of the first written byte
+ * @param len  number of bytes written to each AX-12
+ * @param n  number of AX-12
+ * @param ids  IDs of the AX-12, \e n values
+ * @param data  data to write, \e len bytes for each AX-12, in \e ids order
+ *
+ * Parameters are streamed and not limited by \ref AX12_MAX_PARAMS, but the
+ * packet length (\e n * (\e len + 1) + 4) must not exceed 255.
+ */
+uint8_t ax12_sync_write(ax12_t *s, ax12_addr_t addr, uint8_t len, uint8_t n,
+                        const uint8_t ids[], const uint8_t data[]);
+
 //@}
 
 
 /// Ping an AX-12, return the error register
 uint8_t ax12_ping(ax12_t *s, uint8_t id);
 
+/// Perform writes registered with ax12_reg_write_mem()
+uint8_t ax12_action(ax12_t *s, uint8_t id);
+
 /// Reset AX-12 back to factory settings
 uint8_t ax12_reset(ax12_t *s, uint8_t id);
 
 
+/** @name Coordinated motion
+ *
+ * Writes are registered (REG_WRITE) on each AX-12 of a group, during slack
+ * time. All AX-12 then perform them at the same instant, on a single
+ * broadcast ACTION.
+ *
+ * @note A broadcast ACTION also triggers writes registered on AX-12 outside
+ * the group.
+ */
+//@{
+
+/// Maximum number of AX-12 in a group
+#define AX12_GROUP_MAX_SIZE  16
+
+/// Group of AX-12 for coordinated motion
+typedef struct {
+  uint8_t n;  ///< number of AX-12, at most AX12_GROUP_MAX_SIZE
+  const uint8_t *ids;  ///< IDs of the AX-12
+  uint16_t staged;  ///< bitmask of AX-12 which acknowledged their registered write
+
+} ax12_group_t;
+
+/** @brief Initialize a group, \e ids must remain valid
+ *
+ * Return false if \e n is larger than \ref AX12_GROUP_MAX_SIZE. The group is
+ * then left empty.
+ */
+bool ax12_group_init(ax12_group_t *group, uint8_t n, const uint8_t *ids);
+
+/** @brief Register a write on a single AX-12 of a group
+ *
+ * @param i  index of the AX-12 in the group
+ */
+uint8_t ax12_group_stage_one(ax12_t *s, ax12_group_t *group, uint8_t i,
+                             ax12_addr_t addr, uint8_t len, const uint8_t *data);
+
+/** @brief Register a write on all AX-12 of a group
+ *
+ * @param data  data to write, \e len bytes for each AX-12, in group order
+ *
+ * All writes are attempted. Return the first error.
+ */
+uint8_t ax12_group_stage(ax12_t *s, ax12_group_t *group,
+                         ax12_addr_t addr, uint8_t len, const uint8_t *data);
+
+/// Return true if all AX-12 of a group acknowledged their registered write
+bool ax12_group_ready(const ax12_group_t *group);
+
+/// Broadcast ACTION, reset staged writes of the group
+uint8_t ax12_group_action(ax12_t *s, ax12_group_t *group);
+
+//@}
+
+
 /// Convert a payload (signed) word to a 10-bit signed value
 #define AX12_WORD_TO_SIGNED(x)  (((x) & 0x400) ? -((x) & 0x3FF) : (x))
 /// Convert a 10-bit signed value to a payload (signed) word
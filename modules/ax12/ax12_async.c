@@ -0,0 +1,181 @@
+/**
+ * @cond internal
+ * @file
+ */
+#include "ax12.h"
+// Don't attempt to define anything if asynchronous transactions are disabled
+#ifdef AX12_ASYNC_QUEUE_SIZE
+
+#include <stddef.h>
+#include <avarix/intlvl.h>
+#include <timer/uptime.h>
+#include "ax12_async.h"
+
+
+#ifdef AX12_ASYNC_INTLVL
+# define AX12_ASYNC_INTLVL_DISABLE()  INTLVL_DISABLE_BLOCK(AX12_ASYNC_INTLVL)
+#else
+# define AX12_ASYNC_INTLVL_DISABLE()
+#endif
+
+
+void ax12_async_init(ax12_async_t *a, ax12_t *s)
+{
+  a->ax12 = s;
+  a->head = 0;
+  a->count = 0;
+  a->waiting = false;
+}
+
+
+/// Queue a transaction, with optional streamed SYNC_WRITE data
+static bool ax12_async_queue(ax12_async_t *a, const ax12_pkt_t *pkt,
+                             const uint8_t ids[], const uint8_t data[],
+                             ax12_async_callback_t *cb, void *arg)
+{
+  bool ret = false;
+  AX12_ASYNC_INTLVL_DISABLE() {
+    if(a->count < AX12_ASYNC_QUEUE_SIZE) {
+      uint8_t i = a->head + a->count;
+      if(i >= AX12_ASYNC_QUEUE_SIZE) {
+        i -= AX12_ASYNC_QUEUE_SIZE;
+      }
+      ax12_async_xfer_t *xfer = &a->queue[i];
+      xfer->pkt = *pkt;
+      xfer->ids = ids;
+      xfer->data = data;
+      xfer->cb = cb;
+      xfer->arg = arg;
+      a->count++;
+      ret = true;
+    }
+  }
+  return ret;
+}
+
+bool ax12_async_submit(ax12_async_t *a, const ax12_pkt_t *pkt, ax12_async_callback_t *cb, void *arg)
+{
+  return ax12_async_queue(a, pkt, NULL, NULL, cb, arg);
+}
+
+bool ax12_async_submit_sync_write(ax12_async_t *a, ax12_addr_t addr, uint8_t len, uint8_t n,
+                                  const uint8_t ids[], const uint8_t data[],
+                                  ax12_async_callback_t *cb, void *arg)
+{
+  // parameters are kept in the packet, for ax12_sync_write()
+  const ax12_pkt_t pkt = {
+    .id = AX12_BROADCAST_ID,
+    .instruction = AX12_INSTR_SYNC_WRITE,
+    .nparams = 3,
+    .params = { addr, len, n },
+  };
+  return ax12_async_queue(a, &pkt, ids, data, cb, arg);
+}
+
+
+uint8_t ax12_async_pending(const ax12_async_t *a)
+{
+  return a->count;
+}
+
+
+/** @brief Receive available reply bytes of the current transaction
+ *
+ * Return true when the transaction is complete, with error set.
+ */
+static bool ax12_async_recv(ax12_async_t *a, ax12_async_xfer_t *xfer)
+{
+  ax12_pkt_t *pkt = &xfer->pkt;
+  for(;;) {
+    const int c = a->ax12->recv_nowait();
+    if(c == -1) {
+      return false;
+    }
+    const uint8_t pos = a->pos++;
+    if(pos < 2) {
+      // start bytes
+      if(c != 0xFF) {
+        xfer->error = AX12_ERROR_INVALID_PACKET;
+        return true;
+      }
+    } else if(pos == 2) {
+      // ID, must match the request
+      if(c != pkt->id) {
+        xfer->error = AX12_ERROR_INVALID_PACKET;
+        return true;
+      }
+      pkt->instruction = 0;
+      a->checksum = c;
+    } else if(pos == 3) {
+      // length
+      pkt->nparams = c - 2;
+      if(pkt->nparams > AX12_MAX_PARAMS) {
+        xfer->error = AX12_ERROR_INVALID_PACKET;
+        return true;
+      }
+      a->checksum += c;
+    } else if(pos == 4) {
+      // error
+      pkt->error = c;
+      a->checksum += c;
+    } else if(pos < 5 + pkt->nparams) {
+      // parameters
+      pkt->params[pos-5] = c;
+      a->checksum += c;
+    } else {
+      // checksum
+      if(c != (uint8_t)~a->checksum) {
+        xfer->error = AX12_ERROR_BAD_CHECKSUM;
+      } else {
+        xfer->error = pkt->error;
+      }
+      return true;
+    }
+  }
+}
+
+
+void ax12_async_update(ax12_async_t *a)
+{
+  while(a->count) {
+    ax12_async_xfer_t *xfer = &a->queue[a->head];
+
+    if(!a->waiting) {
+      if(xfer->ids) {
+        const uint8_t *params = xfer->pkt.params;
+        xfer->error = ax12_sync_write(a->ax12, params[0], params[1], params[2], xfer->ids, xfer->data);
+      } else {
+        xfer->error = ax12_send(a->ax12, &xfer->pkt);
+      }
+      if(xfer->error == 0 && xfer->pkt.id != AX12_BROADCAST_ID) {
+        a->waiting = true;
+        a->pos = 0;
+        a->deadline = uptime_us() + AX12_ASYNC_REPLY_TIMEOUT_US;
+      }
+    }
+
+    if(a->waiting) {
+      if(!ax12_async_recv(a, xfer)) {
+        if((int32_t)(uptime_us() - a->deadline) < 0) {
+          return;  // wait for more data
+        }
+        xfer->error = a->pos ? AX12_ERROR_REPLY_TIMEOUT : AX12_ERROR_NO_REPLY;
+      }
+      a->waiting = false;
+    }
+
+    // transaction is complete
+    if(xfer->cb) {
+      xfer->cb(a, xfer);
+    }
+    AX12_ASYNC_INTLVL_DISABLE() {
+      if(++a->head == AX12_ASYNC_QUEUE_SIZE) {
+        a->head = 0;
+      }
+      a->count--;
+    }
+  }
+}
+
+#endif
+///@endcond
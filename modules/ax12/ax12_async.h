@@ -0,0 +1,119 @@
+/** @addtogroup ax12 */
+//@{
+/** @file
+ * @brief AX-12 asynchronous transactions
+ */
+/** @name Asynchronous transactions
+ *
+ * Transactions are queued and processed in order by ax12_async_update(),
+ * which never waits for a reply. It is intended to be called periodically,
+ * typically from a timer callback; the main loop is then free while AX-12
+ * reply.
+ *
+ * Only replies are asynchronous: packets are sent with ax12_send(), which
+ * blocks until the whole packet has been transmitted.
+ *
+ * The bus is owned by the engine while transactions are pending (see
+ * ax12_async_pending()). Synchronous AX-12 functions must not be used on the
+ * same bus meanwhile, since packets and replies would be mixed up.
+ *
+ * The \ref ax12_t::recv_nowait "recv_nowait" callback must be set.
+ *
+ * Completion callbacks are called from ax12_async_update(). They can submit
+ * new transactions.
+ */
+//@{
+#ifndef AX12_ASYNC_H__
+#define AX12_ASYNC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ax12.h"
+
+#ifndef AX12_ASYNC_QUEUE_SIZE
+# error AX12_ASYNC_QUEUE_SIZE must be defined to use asynchronous transactions
+#endif
+#ifdef HOST_VERSION
+# error AX-12 asynchronous transactions require uptime, not available on host
+#endif
+
+#ifdef DOXYGEN
+// Doxygen trick to have the typedef name for struct documentation
+/** @cond skip */
+#define ax12_async_struct ax12_async_t
+/** @endcond */
+#endif
+
+typedef struct ax12_async_struct ax12_async_t;
+
+typedef struct ax12_async_xfer_struct ax12_async_xfer_t;
+
+/** @brief Transaction completion callback
+ *
+ * \e xfer is only valid during the call.
+ */
+typedef void ax12_async_callback_t(ax12_async_t *a, const ax12_async_xfer_t *xfer);
+
+/// Asynchronous transaction
+struct ax12_async_xfer_struct {
+  ax12_pkt_t pkt;  ///< sent packet, replaced by the status packet on reply
+  const uint8_t *ids;  ///< AX-12 IDs of a streamed SYNC_WRITE, NULL otherwise
+  const uint8_t *data;  ///< data of a streamed SYNC_WRITE
+  uint8_t error;  ///< transaction result, an \ref ax12_error_t value
+  ax12_async_callback_t *cb;  ///< completion callback, or NULL
+  void *arg;  ///< user data passed to the callback
+};
+
+/// Asynchronous transaction engine
+struct ax12_async_struct {
+  ax12_t *ax12;  ///< AX-12 connection interface
+  ax12_async_xfer_t queue[AX12_ASYNC_QUEUE_SIZE];  ///< queued transactions
+  uint8_t head;  ///< index of the current transaction
+  uint8_t count;  ///< number of queued transactions
+  bool waiting;  ///< true when waiting for a reply of the current transaction
+  uint8_t pos;  ///< number of received reply bytes
+  uint8_t checksum;  ///< reply checksum being computed
+  uint32_t deadline;  ///< uptime at which the reply times out
+};
+
+
+/// Initialize an asynchronous transaction engine
+void ax12_async_init(ax12_async_t *a, ax12_t *s);
+
+/** @brief Queue a transaction
+ *
+ * The packet is copied. No reply is expected on broadcast.
+ *
+ * @return false if the queue is full.
+ */
+bool ax12_async_submit(ax12_async_t *a, const ax12_pkt_t *pkt, ax12_async_callback_t *cb, void *arg);
+
+/** @brief Queue a SYNC_WRITE transaction
+ *
+ * Parameters are the same as ax12_sync_write(). The packet is streamed when
+ * sent: \e ids and \e data are not copied and must remain valid until the
+ * transaction completes.
+ *
+ * @return false if the queue is full.
+ */
+bool ax12_async_submit_sync_write(ax12_async_t *a, ax12_addr_t addr, uint8_t len, uint8_t n,
+                                  const uint8_t ids[], const uint8_t data[],
+                                  ax12_async_callback_t *cb, void *arg);
+
+/** @brief Process queued transactions
+ *
+ * Send queued packets, handle received replies and timeouts.
+ * It returns as soon as a reply is being waited for, but blocks while a packet
+ * is being sent.
+ */
+void ax12_async_update(ax12_async_t *a);
+
+/** @brief Return the number of queued transactions, including the current one
+ *
+ * The bus can be used synchronously only when it returns 0.
+ */
+uint8_t ax12_async_pending(const ax12_async_t *a);
+
+#endif
+//@}
+//@}
@@ -0,0 +1,355 @@
+/**
+ * @cond internal
+ * @file
+ */
+#include <stddef.h>
+#include <avarix/intlvl.h>
+#include "ax12_p2.h"
+
+
+/// Byte stuffing state, number of matched bytes of the FF FF FD sequence
+typedef uint8_t ax12_p2_stuffing_t;
+
+/** @brief Update byte stuffing state with a payload byte
+ *
+ * Return true if a stuffing byte (0xFD) follows.
+ */
+static bool ax12_p2_stuffing_update(ax12_p2_stuffing_t *m, uint8_t v)
+{
+  if(v == 0xFF) {
+    *m = *m == 2 ? 2 : *m + 1;
+  } else if(v == 0xFD && *m == 2) {
+    *m = 0;
+    return true;
+  } else {
+    *m = 0;
+  }
+  return false;
+}
+
+
+uint16_t ax12_p2_crc(uint16_t crc, const uint8_t *data, uint16_t n)
+{
+  for(uint16_t i=0; i<n; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for(uint8_t j=0; j<8; j++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+
+/// Streaming state of a sent packet
+typedef struct {
+  ax12_t *s;
+  uint16_t crc;
+  ax12_p2_stuffing_t stuffing;
+} ax12_p2_sender_t;
+
+/// Send raw bytes, update the CRC
+static int8_t ax12_p2_send_raw(ax12_p2_sender_t *sender, const uint8_t *data, uint16_t n)
+{
+  for(uint16_t i=0; i<n; i++) {
+    if(sender->s->send(data[i])) {
+      return -1;
+    }
+  }
+  sender->crc = ax12_p2_crc(sender->crc, data, n);
+  return 0;
+}
+
+/// Send payload bytes, with byte stuffing
+static int8_t ax12_p2_send_payload(ax12_p2_sender_t *sender, const uint8_t *data, uint16_t n)
+{
+  static const uint8_t stuffing = 0xFD;
+  for(uint16_t i=0; i<n; i++) {
+    if(ax12_p2_send_raw(sender, &data[i], 1)) {
+      return -1;
+    }
+    if(ax12_p2_stuffing_update(&sender->stuffing, data[i])) {
+      if(ax12_p2_send_raw(sender, &stuffing, 1)) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/// Return the number of stuffing bytes of a payload, update stuffing state
+static uint16_t ax12_p2_stuffing_count(ax12_p2_stuffing_t *m, const uint8_t *data, uint16_t n)
+{
+  uint16_t count = 0;
+  for(uint16_t i=0; i<n; i++) {
+    if(ax12_p2_stuffing_update(m, data[i])) {
+      count++;
+    }
+  }
+  return count;
+}
+
+
+/** @brief Send an instruction packet whose parameters are given in two parts
+ *
+ * This allows to prepend a header to parameters without copying them.
+ */
+static uint8_t ax12_p2_send2(ax12_t *s, uint8_t id, uint8_t instr,
+                             const uint8_t *p1, uint16_t n1, const uint8_t *p2, uint16_t n2)
+{
+  // length: instruction, stuffed parameters, CRC
+  ax12_p2_stuffing_t m = 0;
+  uint16_t len = 1 + n1 + n2 + 2;
+  len += ax12_p2_stuffing_count(&m, &instr, 1);
+  len += ax12_p2_stuffing_count(&m, p1, n1);
+  len += ax12_p2_stuffing_count(&m, p2, n2);
+
+  // switch line to write
+  s->set_state(AX12_STATE_WRITE);
+
+  ax12_p2_sender_t sender = { .s = s, .crc = 0, .stuffing = 0 };
+  const uint8_t header[] = { 0xFF, 0xFF, 0xFD, 0x00, id, len & 0xFF, len >> 8 };
+  if(ax12_p2_send_raw(&sender, header, sizeof(header))) {
+    goto fail;
+  }
+  if(ax12_p2_send_payload(&sender, &instr, 1)) {
+    goto fail;
+  }
+  if(ax12_p2_send_payload(&sender, p1, n1)) {
+    goto fail;
+  }
+  if(ax12_p2_send_payload(&sender, p2, n2)) {
+    goto fail;
+  }
+
+  const uint16_t crc = sender.crc;
+  if(s->send(crc & 0xFF)) {
+    goto fail;
+  }
+  // lock before sending last byte, see ax12_send()
+  INTLVL_DISABLE_ALL_BLOCK() {
+    if(s->send(crc >> 8)) {
+      goto fail;
+    }
+    s->set_state(AX12_STATE_READ);
+  }
+
+  return 0;
+
+ fail:
+  s->set_state(AX12_STATE_READ);
+  return AX12_ERROR_SEND_FAILED;
+}
+
+
+uint8_t ax12_p2_send(ax12_t *s, uint8_t id, uint8_t instr, const uint8_t *params, uint16_t n)
+{
+  return ax12_p2_send2(s, id, instr, params, n, NULL, 0);
+}
+
+
+uint8_t ax12_p2_recv(ax12_t *s, uint8_t id, uint8_t *data, uint16_t n)
+{
+  int c;
+  uint8_t buf[7];
+  s->set_state(AX12_STATE_READ);
+
+  // header, ID, length
+  for(uint8_t i=0; i<sizeof(buf); i++) {
+    c = s->recv();
+    if(c == -1) {
+      return i == 0 ? AX12_ERROR_NO_REPLY : AX12_ERROR_REPLY_TIMEOUT;
+    }
+    buf[i] = c;
+  }
+  if(buf[0] != 0xFF || buf[1] != 0xFF || buf[2] != 0xFD || buf[3] != 0x00) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  if(id != AX12_BROADCAST_ID && buf[4] != id) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  const uint16_t len = buf[5] | (buf[6] << 8);
+  if(len < 4) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  uint16_t crc = ax12_p2_crc(0, buf, sizeof(buf));
+
+  // instruction, error
+  for(uint8_t i=0; i<2; i++) {
+    c = s->recv();
+    if(c == -1) {
+      return AX12_ERROR_REPLY_TIMEOUT;
+    }
+    buf[i] = c;
+  }
+  crc = ax12_p2_crc(crc, buf, 2);
+  const uint8_t error = buf[1];
+  bool valid = buf[0] == AX12_P2_INSTR_STATUS;
+
+  // parameters, unstuffed and written directly to data
+  ax12_p2_stuffing_t m = 0;
+  ax12_p2_stuffing_update(&m, buf[0]);
+  ax12_p2_stuffing_update(&m, buf[1]);
+  bool stuffed = false;
+  uint16_t k = 0;
+  for(uint16_t i=0; i<len-4; i++) {
+    c = s->recv();
+    if(c == -1) {
+      return AX12_ERROR_REPLY_TIMEOUT;
+    }
+    const uint8_t v = c;
+    crc = ax12_p2_crc(crc, &v, 1);
+    if(stuffed) {
+      stuffed = false;  // skip stuffing byte
+      continue;
+    }
+    stuffed = ax12_p2_stuffing_update(&m, v);
+    if(k < n) {
+      data[k] = v;
+    }
+    k++;
+  }
+
+  // CRC
+  for(uint8_t i=0; i<2; i++) {
+    c = s->recv();
+    if(c == -1) {
+      return AX12_ERROR_REPLY_TIMEOUT;
+    }
+    buf[i] = c;
+  }
+  if((buf[0] | (buf[1] << 8)) != crc) {
+    return AX12_ERROR_BAD_CHECKSUM;
+  }
+  if(!valid || (!(error & 0x7F) && k != n)) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  return error & 0x7F;
+}
+
+
+uint8_t ax12_p2_ping(ax12_t *s, uint8_t id)
+{
+  uint8_t ret;
+  if((ret = ax12_p2_send(s, id, AX12_P2_INSTR_PING, NULL, 0))) {
+    return ret;
+  }
+  if(id == AX12_BROADCAST_ID) {
+    return 0;  // no reply on broadcast
+  }
+  uint8_t info[3];  // model number, firmware version
+  return ax12_p2_recv(s, id, info, sizeof(info));
+}
+
+
+uint8_t ax12_p2_write(ax12_t *s, uint8_t id, uint16_t addr, uint16_t n, const uint8_t *data)
+{
+  const uint8_t header[] = { addr & 0xFF, addr >> 8 };
+  uint8_t ret;
+  if((ret = ax12_p2_send2(s, id, AX12_P2_INSTR_WRITE, header, sizeof(header), data, n))) {
+    return ret;
+  }
+  if(id == AX12_BROADCAST_ID) {
+    return 0;  // no reply on broadcast
+  }
+  return ax12_p2_recv(s, id, NULL, 0);
+}
+
+
+uint8_t ax12_p2_read(ax12_t *s, uint8_t id, uint16_t addr, uint16_t n, uint8_t *data)
+{
+  if(id == AX12_BROADCAST_ID) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  const uint8_t params[] = { addr & 0xFF, addr >> 8, n & 0xFF, n >> 8 };
+  uint8_t ret;
+  if((ret = ax12_p2_send(s, id, AX12_P2_INSTR_READ, params, sizeof(params)))) {
+    return ret;
+  }
+  return ax12_p2_recv(s, id, data, n);
+}
+
+
+/** @brief Return true if a reply reception failed
+ *
+ * Status packet errors are reported in a properly received reply. Other errors
+ * leave the reception stream in an unknown state.
+ */
+static bool ax12_p2_recv_failed(uint8_t ret)
+{
+  return ret >= AX12_ERROR_INVALID_PACKET;
+}
+
+uint8_t ax12_p2_sync_read(ax12_t *s, uint16_t addr, uint16_t len, uint8_t n,
+                          const uint8_t ids[], uint8_t data[], uint8_t errors[])
+{
+  if(n == 0) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  const uint8_t header[] = { addr & 0xFF, addr >> 8, len & 0xFF, len >> 8 };
+  uint8_t ret;
+  if((ret = ax12_p2_send2(s, AX12_BROADCAST_ID, AX12_P2_INSTR_SYNC_READ, header, sizeof(header), ids, n))) {
+    return ret;
+  }
+  // replies are sent in request order
+  uint8_t err = 0;
+  for(uint8_t i=0; i<n; i++) {
+    ret = ax12_p2_recv(s, ids[i], data, len);
+    if(errors) {
+      errors[i] = ret;
+    }
+    if(ret && !err) {
+      err = ret;
+    }
+    if(ax12_p2_recv_failed(ret)) {
+      // next replies would be parsed out of sync
+      if(errors) {
+        while(++i < n) {
+          errors[i] = AX12_ERROR_NO_REPLY;
+        }
+      }
+      break;
+    }
+    data += len;
+  }
+  return err;
+}
+
+
+uint8_t ax12_p2_bulk_read(ax12_t *s, ax12_p2_bulk_read_t *reads, uint8_t n)
+{
+  if(n == 0) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  uint8_t params[5*n];
+  for(uint8_t i=0; i<n; i++) {
+    const ax12_p2_bulk_read_t *r = &reads[i];
+    params[5*i+0] = r->id;
+    params[5*i+1] = r->addr & 0xFF;
+    params[5*i+2] = r->addr >> 8;
+    params[5*i+3] = r->len & 0xFF;
+    params[5*i+4] = r->len >> 8;
+  }
+  uint8_t ret;
+  if((ret = ax12_p2_send(s, AX12_BROADCAST_ID, AX12_P2_INSTR_BULK_READ, params, sizeof(params)))) {
+    return ret;
+  }
+  // replies are sent in request order
+  uint8_t err = 0;
+  for(uint8_t i=0; i<n; i++) {
+    ax12_p2_bulk_read_t *r = &reads[i];
+    r->error = ax12_p2_recv(s, r->id, r->data, r->len);
+    if(r->error && !err) {
+      err = r->error;
+    }
+    if(ax12_p2_recv_failed(r->error)) {
+      // next replies would be parsed out of sync
+      while(++i < n) {
+        reads[i].error = AX12_ERROR_NO_REPLY;
+      }
+      break;
+    }
+  }
+  return err;
+}
+
+///@endcond
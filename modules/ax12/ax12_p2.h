@@ -0,0 +1,102 @@
+/** @addtogroup ax12 */
+//@{
+/** @file
+ * @brief Dynamixel Protocol 2.0
+ */
+/** @name Protocol 2.0
+ *
+ * Protocol 2.0 is used by X-series servomotors. Packets use a CRC-16 and
+ * byte stuffing, addresses are 16-bit.
+ *
+ * The same \ref ax12_t interface is used, packets are streamed through its
+ * callbacks. Replies are received directly into caller buffers.
+ *
+ * Status error numbers are returned as is (7 lowest bits). The hardware
+ * alert bit is ignored.
+ */
+//@{
+#ifndef AX12_P2_H__
+#define AX12_P2_H__
+
+#include <stdint.h>
+#include "ax12.h"
+
+
+/// Protocol 2.0 instruction value
+typedef enum {
+  AX12_P2_INSTR_PING = 0x01,
+  AX12_P2_INSTR_READ = 0x02,
+  AX12_P2_INSTR_WRITE = 0x03,
+  AX12_P2_INSTR_REG_WRITE = 0x04,
+  AX12_P2_INSTR_ACTION = 0x05,
+  AX12_P2_INSTR_FACTORY_RESET = 0x06,
+  AX12_P2_INSTR_REBOOT = 0x08,
+  AX12_P2_INSTR_STATUS = 0x55,
+  AX12_P2_INSTR_SYNC_READ = 0x82,
+  AX12_P2_INSTR_SYNC_WRITE = 0x83,
+  AX12_P2_INSTR_BULK_READ = 0x92,
+  AX12_P2_INSTR_BULK_WRITE = 0x93,
+
+} ax12_p2_instruction_t;
+
+/// Read request of a BULK_READ
+typedef struct {
+  uint8_t id;  ///< servomotor ID
+  uint16_t addr;  ///< address of the first read byte
+  uint16_t len;  ///< number of bytes to read
+  uint8_t *data;  ///< buffer for read data
+  uint8_t error;  ///< read result, set by ax12_p2_bulk_read()
+
+} ax12_p2_bulk_read_t;
+
+
+/// Compute the Protocol 2.0 CRC-16 of data, update a previous value
+uint16_t ax12_p2_crc(uint16_t crc, const uint8_t *data, uint16_t n);
+
+/// Send a Protocol 2.0 instruction packet
+uint8_t ax12_p2_send(ax12_t *s, uint8_t id, uint8_t instr, const uint8_t *params, uint16_t n);
+
+/** @brief Receive a Protocol 2.0 status packet
+ *
+ * Status parameters are written to \e data. Their number must be \e n.
+ *
+ * @note On error, \e data may have been partially modified.
+ */
+uint8_t ax12_p2_recv(ax12_t *s, uint8_t id, uint8_t *data, uint16_t n);
+
+/// Ping a servomotor
+uint8_t ax12_p2_ping(ax12_t *s, uint8_t id);
+
+/// Write n bytes to servomotor memory
+uint8_t ax12_p2_write(ax12_t *s, uint8_t id, uint16_t addr, uint16_t n, const uint8_t *data);
+
+/// Read n bytes from servomotor memory
+uint8_t ax12_p2_read(ax12_t *s, uint8_t id, uint16_t addr, uint16_t n, uint8_t *data);
+
+/** @brief Read the same memory range of several servomotors
+ *
+ * A single SYNC_READ packet is sent, servomotors reply back to back.
+ *
+ * @param data  buffer for read data, \e len bytes for each servomotor
+ * @param errors  buffer for the read result of each servomotor, or NULL
+ *
+ * Replies are received until a reception error (timeout, invalid packet, bad
+ * checksum), after which following replies cannot be reliably parsed.
+ * Remaining servomotors are then marked with \ref AX12_ERROR_NO_REPLY.
+ * Return the first error, \ref AX12_ERROR_INVALID_PACKET if \e n is 0.
+ */
+uint8_t ax12_p2_sync_read(ax12_t *s, uint16_t addr, uint16_t len, uint8_t n,
+                          const uint8_t ids[], uint8_t data[], uint8_t errors[]);
+
+/** @brief Read memory ranges of several servomotors
+ *
+ * A single BULK_READ packet is sent, servomotors reply back to back.
+ *
+ * Reception errors are handled as with ax12_p2_sync_read().
+ * Return the first error, \ref AX12_ERROR_INVALID_PACKET if \e n is 0.
+ */
+uint8_t ax12_p2_bulk_read(ax12_t *s, ax12_p2_bulk_read_t *reads, uint8_t n);
+
+#endif
+//@}
+//@}
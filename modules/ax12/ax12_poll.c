@@ -0,0 +1,126 @@
+/**
+ * @cond internal
+ * @file
+ */
+#include "ax12.h"
+// Don't attempt to define anything if state polling is disabled
+#ifdef AX12_POLL_SIZE
+
+#include <avarix/intlvl.h>
+#include "ax12_poll.h"
+
+_Static_assert(sizeof(ax12_poll_state_t) == AX12_ADDR_PRESENT_TEMP - AX12_ADDR_PRESENT_POSITION_L + 1,
+               "ax12_poll_state_t does not match AX-12 memory layout");
+
+
+void ax12_poll_init(ax12_poll_t *poll)
+{
+  poll->n = 0;
+  poll->next = 0;
+#ifdef AX12_ASYNC_QUEUE_SIZE
+  poll->pending = false;
+#endif
+}
+
+
+bool ax12_poll_add(ax12_poll_t *poll, uint8_t id)
+{
+  if(poll->n >= AX12_POLL_SIZE) {
+    return false;
+  }
+  poll->ids[poll->n] = id;
+  poll->states[poll->n] = (ax12_poll_state_t){ 0 };
+  poll->errors[poll->n] = AX12_ERROR_NO_REPLY;
+  poll->n++;
+  return true;
+}
+
+
+/// Store a read result
+static void ax12_poll_store(ax12_poll_t *poll, uint8_t i, uint8_t error, const ax12_poll_state_t *state)
+{
+  INTLVL_DISABLE_ALL_BLOCK() {
+    poll->errors[i] = error;
+    if(!error) {
+      poll->states[i] = *state;
+    }
+  }
+}
+
+
+uint8_t ax12_poll_update(ax12_t *s, ax12_poll_t *poll)
+{
+  if(poll->n == 0) {
+    return 0;
+  }
+  const uint8_t i = poll->next;
+  poll->next = i+1 < poll->n ? i+1 : 0;
+
+  // data is received directly in the (little endian) state structure
+  ax12_poll_state_t state;
+  uint8_t ret = ax12_read_mem(s, poll->ids[i], AX12_ADDR_PRESENT_POSITION_L,
+                              sizeof(state), (uint8_t *)&state);
+  ax12_poll_store(poll, i, ret, &state);
+  return ret;
+}
+
+
+#ifdef AX12_ASYNC_QUEUE_SIZE
+
+/// Completion callback of asynchronous reads
+static void ax12_poll_async_callback(ax12_async_t *a, const ax12_async_xfer_t *xfer)
+{
+  ax12_poll_t *poll = xfer->arg;
+  for(uint8_t i=0; i<poll->n; i++) {
+    if(poll->ids[i] == xfer->pkt.id) {
+      uint8_t error = xfer->error;
+      if(!error && xfer->pkt.nparams != sizeof(ax12_poll_state_t)) {
+        error = AX12_ERROR_INVALID_PACKET;
+      }
+      ax12_poll_store(poll, i, error, (const ax12_poll_state_t *)xfer->pkt.params);
+      break;
+    }
+  }
+  poll->pending = false;
+}
+
+void ax12_poll_update_async(ax12_async_t *a, ax12_poll_t *poll)
+{
+  if(poll->n == 0 || poll->pending) {
+    return;
+  }
+  const uint8_t i = poll->next;
+  const ax12_pkt_t pkt = {
+    .id = poll->ids[i],
+    .instruction = AX12_INSTR_READ,
+    .nparams = 2,
+    .params = { AX12_ADDR_PRESENT_POSITION_L, sizeof(ax12_poll_state_t) },
+  };
+  poll->pending = true;
+  if(ax12_async_submit(a, &pkt, ax12_poll_async_callback, poll)) {
+    poll->next = i+1 < poll->n ? i+1 : 0;
+  } else {
+    poll->pending = false;
+  }
+}
+
+#endif
+
+
+uint8_t ax12_poll_get(const ax12_poll_t *poll, uint8_t id, ax12_poll_state_t *state)
+{
+  for(uint8_t i=0; i<poll->n; i++) {
+    if(poll->ids[i] == id) {
+      uint8_t ret;
+      INTLVL_DISABLE_ALL_BLOCK() {
+        ret = poll->errors[i];
+        *state = poll->states[i];
+      }
+      return ret;
+    }
+  }
+  return AX12_ERROR_INVALID_PACKET;
+}
+
+#endif
+///@endcond
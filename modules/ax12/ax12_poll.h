@@ -0,0 +1,90 @@
+/** @addtogroup ax12 */
+//@{
+/** @file
+ * @brief AX-12 state polling
+ */
+/** @name State polling
+ *
+ * Registered AX-12 are read in turn, one for each update. Their present
+ * state is cached and can be retrieved without accessing the bus.
+ *
+ * Updates are typically run from a timer callback. Retrieving a state is
+ * safe from any context.
+ */
+//@{
+#ifndef AX12_POLL_H__
+#define AX12_POLL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ax12.h"
+#ifdef AX12_ASYNC_QUEUE_SIZE
+#include "ax12_async.h"
+#endif
+
+#ifndef AX12_POLL_SIZE
+# error AX12_POLL_SIZE must be defined to use state polling
+#endif
+
+/** @brief Cached AX-12 state
+ *
+ * Fields are read from \ref AX12_ADDR_PRESENT_POSITION_L to
+ * \ref AX12_ADDR_PRESENT_TEMP, and must match their layout.
+ */
+typedef struct {
+  uint16_t position;  ///< present position
+  uint16_t speed;  ///< present speed
+  uint16_t load;  ///< present load
+  uint8_t voltage;  ///< present voltage
+  uint8_t temperature;  ///< present temperature
+
+} __attribute__((__packed__)) ax12_poll_state_t;
+
+/// AX-12 state polling
+typedef struct {
+  uint8_t n;  ///< number of registered AX-12
+  uint8_t next;  ///< index of the next AX-12 to read
+  uint8_t ids[AX12_POLL_SIZE];  ///< IDs of registered AX-12
+  ax12_poll_state_t states[AX12_POLL_SIZE];  ///< cached states
+  uint8_t errors[AX12_POLL_SIZE];  ///< result of the last read
+#ifdef AX12_ASYNC_QUEUE_SIZE
+  bool pending;  ///< true if an asynchronous read is pending
+#endif
+
+} ax12_poll_t;
+
+
+/// Initialize state polling
+void ax12_poll_init(ax12_poll_t *poll);
+
+/** @brief Register an AX-12 to poll
+ *
+ * Return false if there is no room left.
+ */
+bool ax12_poll_add(ax12_poll_t *poll, uint8_t id);
+
+/** @brief Read the state of the next AX-12
+ *
+ * Return the read result.
+ */
+uint8_t ax12_poll_update(ax12_t *s, ax12_poll_t *poll);
+
+#if (defined DOXYGEN) || (defined AX12_ASYNC_QUEUE_SIZE)
+/** @brief Queue an asynchronous read of the next AX-12
+ *
+ * Nothing is done if the previous read is still pending.
+ */
+void ax12_poll_update_async(ax12_async_t *a, ax12_poll_t *poll);
+#endif
+
+/** @brief Retrieve the cached state of an AX-12
+ *
+ * Return the result of the last read, \ref AX12_ERROR_NO_REPLY if the AX-12
+ * has not been read yet, \ref AX12_ERROR_INVALID_PACKET if it is not
+ * registered. State is only updated on success.
+ */
+uint8_t ax12_poll_get(const ax12_poll_t *poll, uint8_t id, ax12_poll_state_t *state);
+
+#endif
+//@}
+//@}
@@ -0,0 +1,172 @@
+/**
+ * @cond internal
+ * @file
+ */
+#include "ax12.h"
+// Don't attempt to define anything if register shadows are disabled
+#ifdef AX12_SHADOW_ADDR_START
+
+#include <stdbool.h>
+#include <string.h>
+#include "ax12_shadow.h"
+
+_Static_assert(AX12_SHADOW_SIZE > 0 && AX12_SHADOW_SIZE <= 16,
+               "shadowed range must be between 1 and 16 bytes");
+_Static_assert(AX12_SHADOW_SIZE < AX12_MAX_PARAMS,
+               "shadowed range must fit in AX12_MAX_PARAMS");
+
+/// Maximum number of AX-12 in a SYNC_WRITE sent by ax12_shadow_sync_flush()
+#define AX12_SHADOW_SYNC_BATCH  16
+/// Maximum data size of a SYNC_WRITE sent by ax12_shadow_sync_flush()
+#define AX12_SHADOW_SYNC_DATA_SIZE  64
+
+
+void ax12_shadow_init(ax12_shadow_t *sh, uint8_t id)
+{
+  sh->id = id;
+  sh->valid = 0;
+  sh->dirty = 0;
+}
+
+
+uint8_t ax12_shadow_set_byte(ax12_shadow_t *sh, ax12_addr_t addr, uint8_t data)
+{
+  if(addr < AX12_SHADOW_ADDR_START || addr > AX12_SHADOW_ADDR_END) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  const uint8_t i = addr - AX12_SHADOW_ADDR_START;
+  const uint16_t bit = (uint16_t)1 << i;
+  if(!(sh->valid & bit) || sh->mem[i] != data) {
+    sh->mem[i] = data;
+    sh->valid |= bit;
+    sh->dirty |= bit;
+  }
+  return 0;
+}
+
+uint8_t ax12_shadow_set_word(ax12_shadow_t *sh, ax12_addr_t addr, uint16_t data)
+{
+  if(addr == AX12_SHADOW_ADDR_END) {
+    return AX12_ERROR_INVALID_PACKET;
+  }
+  uint8_t ret;
+  if((ret = ax12_shadow_set_byte(sh, addr, data & 0xFF))) {
+    return ret;
+  }
+  return ax12_shadow_set_byte(sh, addr+1, data >> 8);
+}
+
+
+/** @brief Get the range covering dirty bits of a mask
+ *
+ * Return false if there is no dirty bits.
+ */
+static bool ax12_shadow_dirty_range(uint16_t dirty, uint8_t *first, uint8_t *last)
+{
+  if(!dirty) {
+    return false;
+  }
+  uint8_t i = 0;
+  while(!(dirty & ((uint16_t)1 << i))) {
+    i++;
+  }
+  *first = i;
+  while(dirty >> (i+1)) {
+    i++;
+  }
+  *last = i;
+  return true;
+}
+
+/// Return the mask of bits from first to last (included)
+static uint16_t ax12_shadow_range_mask(uint8_t first, uint8_t last)
+{
+  return (uint16_t)((0xFFFFu >> (15 - last)) & (0xFFFFu << first));
+}
+
+
+uint8_t ax12_shadow_flush(ax12_t *s, ax12_shadow_t *sh)
+{
+  uint8_t first, last;
+  while(ax12_shadow_dirty_range(sh->dirty, &first, &last)) {
+    // stop before the first unknown byte
+    uint8_t end = first;
+    while(end < last && (sh->valid & ((uint16_t)1 << (end+1)))) {
+      end++;
+    }
+    uint8_t ret = ax12_write_mem(s, sh->id, AX12_SHADOW_ADDR_START + first,
+                                 end - first + 1, &sh->mem[first]);
+    if(ret) {
+      return ret;
+    }
+    sh->dirty &= ~ax12_shadow_range_mask(first, end);
+  }
+  return 0;
+}
+
+
+uint8_t ax12_shadow_sync_flush(ax12_t *s, ax12_shadow_t *shadows, uint8_t n)
+{
+  // union of dirty bytes
+  uint16_t dirty = 0;
+  for(uint8_t i=0; i<n; i++) {
+    dirty |= shadows[i].dirty;
+  }
+  uint8_t first, last;
+  if(!ax12_shadow_dirty_range(dirty, &first, &last)) {
+    return 0;
+  }
+  const uint16_t mask = ax12_shadow_range_mask(first, last);
+  const uint8_t len = last - first + 1;
+
+  // shadows are synchronized in batches fitting the buffer and a packet
+  // length field: instruction, address, length, parameters, checksum
+  uint8_t batch = AX12_SHADOW_SYNC_DATA_SIZE / len;
+  if(batch > AX12_SHADOW_SYNC_BATCH) {
+    batch = AX12_SHADOW_SYNC_BATCH;
+  }
+  if(batch > (0xFF - 4) / (len + 1)) {
+    batch = (0xFF - 4) / (len + 1);
+  }
+
+  uint8_t ids[AX12_SHADOW_SYNC_BATCH];
+  uint8_t indexes[AX12_SHADOW_SYNC_BATCH];
+  uint8_t data[AX12_SHADOW_SYNC_DATA_SIZE];
+  uint8_t i = 0;
+  while(i < n) {
+    // collect a batch of shadows which can be synchronized
+    uint8_t nsync = 0;
+    for(; i<n && nsync<batch; i++) {
+      const ax12_shadow_t *sh = &shadows[i];
+      if(sh->dirty && (sh->valid & mask) == mask) {
+        ids[nsync] = sh->id;
+        indexes[nsync] = i;
+        memcpy(&data[nsync * len], &sh->mem[first], len);
+        nsync++;
+      }
+    }
+    // a single AX-12 is flushed individually: a regular write is not longer
+    // and gets a reply
+    if(nsync > 1 && ax12_sync_write(s, AX12_SHADOW_ADDR_START + first, len, nsync, ids, data) == 0) {
+      for(uint8_t j=0; j<nsync; j++) {
+        shadows[indexes[j]].dirty = 0;
+      }
+    }
+  }
+
+  // flush other shadows, and those of failed SYNC_WRITE, individually
+  uint8_t ret = 0;
+  for(i=0; i<n; i++) {
+    ax12_shadow_t *sh = &shadows[i];
+    if(sh->dirty) {
+      const uint8_t r = ax12_shadow_flush(s, sh);
+      if(r && !ret) {
+        ret = r;
+      }
+    }
+  }
+  return ret;
+}
+
+#endif
+///@endcond
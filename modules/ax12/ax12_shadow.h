@@ -0,0 +1,75 @@
+/** @addtogroup ax12 */
+//@{
+/** @file
+ * @brief AX-12 register shadows
+ */
+/** @name Register shadows
+ *
+ * A shadow holds a local copy of a range of the control table of an AX-12
+ * (from \ref AX12_SHADOW_ADDR_START to \ref AX12_SHADOW_ADDR_END).
+ *
+ * Setters only update the shadow and mark modified bytes as dirty. Writing
+ * the value already written to the AX-12 does nothing. Dirty bytes are then
+ * written to the AX-12 by a flush.
+ *
+ * Initial shadow values are unknown; a byte is only written back to the
+ * AX-12 if it has been set at least once.
+ */
+//@{
+#ifndef AX12_SHADOW_H__
+#define AX12_SHADOW_H__
+
+#include <stdint.h>
+#include "ax12.h"
+
+#ifndef AX12_SHADOW_ADDR_START
+# error AX12_SHADOW_ADDR_START must be defined to use register shadows
+#endif
+
+/// Size of the shadowed range
+#define AX12_SHADOW_SIZE  (AX12_SHADOW_ADDR_END - AX12_SHADOW_ADDR_START + 1)
+
+/// Register shadow of an AX-12
+typedef struct {
+  uint8_t id;  ///< AX-12 ID
+  uint8_t mem[AX12_SHADOW_SIZE];  ///< shadowed memory
+  uint16_t valid;  ///< bitmask of bytes whose value is known
+  uint16_t dirty;  ///< bitmask of bytes to write to the AX-12
+
+} ax12_shadow_t;
+
+
+/// Initialize a register shadow, with unknown values
+void ax12_shadow_init(ax12_shadow_t *sh, uint8_t id);
+
+/// Set a byte of a register shadow
+uint8_t ax12_shadow_set_byte(ax12_shadow_t *sh, ax12_addr_t addr, uint8_t data);
+
+/// Set a word (2 bytes) of a register shadow
+uint8_t ax12_shadow_set_word(ax12_shadow_t *sh, ax12_addr_t addr, uint16_t data);
+
+/** @brief Write dirty bytes to the AX-12
+ *
+ * Dirty bytes are written in a single ax12_write_mem(), also rewriting
+ * unchanged bytes between them. Bytes of unknown value are never written, a
+ * write is sent for each range they delimit.
+ */
+uint8_t ax12_shadow_flush(ax12_t *s, ax12_shadow_t *sh);
+
+/** @brief Write dirty bytes of several AX-12
+ *
+ * Dirty bytes of all shadows are written using SYNC_WRITE packets covering
+ * the union of dirty ranges. Shadows are sent in batches, so that packets fit
+ * in a bounded buffer and in the 255-byte packet length.
+ *
+ * Shadows for which this range contains bytes of unknown value are flushed
+ * individually, as well as shadows of a failed SYNC_WRITE. Shadows remain
+ * dirty only if their individual flush fails.
+ *
+ * Return the first error of individual flushes, 0 on success.
+ */
+uint8_t ax12_shadow_sync_flush(ax12_t *s, ax12_shadow_t *shadows, uint8_t n);
+
+#endif
+//@}
+//@}
@@ -0,0 +1,349 @@
+/**
+ * @cond internal
+ * @file
+ */
+#include "ax12.h"
+// Simulator is only available on host
+#ifdef HOST_VERSION
+
+#include <string.h>
+#include "ax12_sim.h"
+
+
+/// Simulated bus state
+static struct {
+  uint32_t baudrate;
+  uint32_t timeout_us;
+  uint8_t nservos;
+  uint8_t ids[AX12_SIM_MAX_SERVOS];
+  ax12_sim_servo_t servos[AX12_SIM_MAX_SERVOS];
+  ax12_state_t state;
+  // instruction packet being received by AX-12
+  uint8_t rx[0xFF + 4];
+  uint16_t rx_len;
+  // status packet being sent by an AX-12
+  uint8_t tx[0xFF + 4];
+  uint16_t tx_len;
+  uint16_t tx_pos;
+  uint32_t tx_delay_us;
+} sim;
+
+ax12_sim_stats_t ax12_sim_stats;
+
+
+/// Simulate the transmission of a byte on the bus
+static void ax12_sim_byte_time(void)
+{
+  const uint64_t ns = 10 * 1000000000ULL / sim.baudrate;
+  ax12_sim_stats.time_ns += ns;
+  ax12_sim_stats.busy_ns += ns;
+}
+
+
+/// Prepare a status packet
+static void ax12_sim_reply(const ax12_sim_servo_t *servo, uint8_t error, const uint8_t *params, uint8_t n)
+{
+  uint8_t *p = sim.tx;
+  *p++ = 0xFF;
+  *p++ = 0xFF;
+  *p++ = servo->mem[AX12_ADDR_ID];
+  *p++ = n + 2;
+  *p++ = error;
+  memcpy(p, params, n);
+  p += n;
+  uint8_t checksum = 0;
+  for(uint8_t *q = sim.tx + 2; q < p; q++) {
+    checksum += *q;
+  }
+  *p++ = ~checksum;
+  sim.tx_len = p - sim.tx;
+  sim.tx_pos = 0;
+  sim.tx_delay_us = 2 * servo->mem[AX12_ADDR_DELAY_TIME];
+}
+
+/// Write to a simulated AX-12 memory
+static uint8_t ax12_sim_write(ax12_sim_servo_t *servo, uint8_t addr, const uint8_t *data, uint8_t n)
+{
+  if(addr + n > AX12_SIM_MEM_SIZE) {
+    return AX12_ERROR_BIT_RANGE;
+  }
+  memcpy(&servo->mem[addr], data, n);
+  // present position immediately reaches goal position
+  memcpy(&servo->mem[AX12_ADDR_PRESENT_POSITION_L], &servo->mem[AX12_ADDR_GOAL_POSITION_L], 2);
+  return 0;
+}
+
+/// Reset a simulated AX-12 to default values
+static void ax12_sim_servo_reset(ax12_sim_servo_t *servo, uint8_t id)
+{
+  memset(servo, 0, sizeof(*servo));
+  servo->mem[AX12_ADDR_MODEL_NUMBER_L] = 12;
+  servo->mem[AX12_ADDR_FIRMWARE_VERSION] = 0x18;
+  servo->mem[AX12_ADDR_ID] = id;
+  servo->mem[AX12_ADDR_BAUD_RATE] = 1;
+  servo->mem[AX12_ADDR_DELAY_TIME] = 250;
+  servo->mem[AX12_ADDR_CCW_ANGLE_LIMIT_L] = 0xFF;
+  servo->mem[AX12_ADDR_CCW_ANGLE_LIMIT_H] = 0x03;
+  servo->mem[AX12_ADDR_HIGHEST_LIMIT_TEMP] = 70;
+  servo->mem[AX12_ADDR_LOWEST_LIMIT_VOLTAGE] = 60;
+  servo->mem[AX12_ADDR_HIGHEST_LIMIT_VOLTAGE] = 140;
+  servo->mem[AX12_ADDR_MAX_TORQUE_L] = 0xFF;
+  servo->mem[AX12_ADDR_MAX_TORQUE_H] = 0x03;
+  servo->mem[AX12_ADDR_STATUS_RETURN_LEVEL] = 2;
+  servo->mem[AX12_ADDR_TORQUE_LIMIT_L] = 0xFF;
+  servo->mem[AX12_ADDR_TORQUE_LIMIT_H] = 0x03;
+  servo->mem[AX12_ADDR_PRESENT_VOLTAGE] = 120;
+  servo->mem[AX12_ADDR_PRESENT_TEMP] = 35;
+  servo->mem[AX12_ADDR_PUNCH_L] = 0x20;
+}
+
+/// Process a complete instruction packet on a simulated AX-12
+static void ax12_sim_process(ax12_sim_servo_t *servo, uint8_t instr, const uint8_t *params, uint8_t n)
+{
+  const uint8_t id = servo->mem[AX12_ADDR_ID];
+  uint8_t error = 0;
+  const uint8_t *data = NULL;
+  uint8_t ndata = 0;
+
+  switch(instr) {
+    case AX12_INSTR_PING:
+      break;
+    case AX12_INSTR_READ:
+      if(n != 2 || params[0] + params[1] > AX12_SIM_MEM_SIZE) {
+        error = AX12_ERROR_BIT_RANGE;
+      } else {
+        data = &servo->mem[params[0]];
+        ndata = params[1];
+      }
+      break;
+    case AX12_INSTR_WRITE:
+      error = n < 2 ? AX12_ERROR_BIT_RANGE : ax12_sim_write(servo, params[0], params + 1, n - 1);
+      break;
+    case AX12_INSTR_REG_WRITE:
+      if(n < 2 || params[0] + n - 1 > AX12_SIM_MEM_SIZE) {
+        error = AX12_ERROR_BIT_RANGE;
+      } else {
+        servo->reg_addr = params[0];
+        servo->reg_len = n - 1;
+        memcpy(servo->reg_data, params + 1, n - 1);
+        servo->mem[AX12_ADDR_REGISTERED_INSTR] = 1;
+      }
+      break;
+    case AX12_INSTR_ACTION:
+      if(servo->reg_len) {
+        ax12_sim_write(servo, servo->reg_addr, servo->reg_data, servo->reg_len);
+        servo->reg_len = 0;
+        servo->mem[AX12_ADDR_REGISTERED_INSTR] = 0;
+      }
+      break;
+    case AX12_INSTR_RESET:
+      ax12_sim_servo_reset(servo, 1);
+      break;
+    case AX12_INSTR_SYNC_WRITE:
+      // params: address, length, then ID and data for each AX-12
+      if(n >= 2 && params[1]) {
+        const uint8_t len = params[1];
+        for(uint16_t i=2; i+len+1 <= n; i+=len+1) {
+          if(params[i] == id) {
+            ax12_sim_write(servo, params[0], &params[i+1], len);
+          }
+        }
+      }
+      return;  // never replied
+    default:
+      error = AX12_ERROR_BIT_INSTRUCTION;
+      break;
+  }
+
+  const uint8_t level = servo->mem[AX12_ADDR_STATUS_RETURN_LEVEL];
+  // PING is always answered
+  if(level == 2 || instr == AX12_INSTR_PING || (level == 1 && instr == AX12_INSTR_READ)) {
+    ax12_sim_reply(servo, error, data, ndata);
+  }
+}
+
+/// Process the received instruction packet, if complete
+static void ax12_sim_rx_packet(void)
+{
+  if(sim.rx_len < 4 || sim.rx_len < sim.rx[3] + 4u) {
+    return;  // incomplete
+  }
+  if(sim.rx[3] < 2) {
+    // malformed, at least instruction and checksum are expected
+    sim.rx_len = 0;
+    return;
+  }
+  const uint8_t id = sim.rx[2];
+  const uint8_t n = sim.rx[3] - 2;
+  const uint8_t instr = sim.rx[4];
+  uint8_t checksum = 0;
+  for(uint16_t i=2; i<sim.rx_len-1u; i++) {
+    checksum += sim.rx[i];
+  }
+  checksum = ~checksum;
+  sim.rx_len = 0;
+  ax12_sim_stats.instructions++;
+
+  if(checksum != sim.rx[4 + n + 1]) {
+    return;  // real AX-12 reply with a checksum error, ignore it here
+  }
+  for(uint8_t i=0; i<sim.nservos; i++) {
+    ax12_sim_servo_t *servo = &sim.servos[i];
+    if(id == AX12_BROADCAST_ID) {
+      // no reply on broadcast
+      const uint16_t tx_len = sim.tx_len;
+      ax12_sim_process(servo, instr, &sim.rx[5], n);
+      sim.tx_len = tx_len;
+    } else if(servo->mem[AX12_ADDR_ID] == id) {
+      ax12_sim_process(servo, instr, &sim.rx[5], n);
+    }
+  }
+}
+
+
+static int8_t ax12_sim_send(uint8_t v)
+{
+  ax12_sim_byte_time();
+  if(sim.state != AX12_STATE_WRITE) {
+    return -1;
+  }
+  // resynchronize on start bytes
+  if(sim.rx_len < 2 && v != 0xFF) {
+    sim.rx_len = 0;
+    return 0;
+  }
+  sim.rx[sim.rx_len++] = v;
+  ax12_sim_rx_packet();
+  return 0;
+}
+
+static int ax12_sim_recv(void)
+{
+  if(sim.tx_pos >= sim.tx_len) {
+    ax12_sim_stats.time_ns += sim.timeout_us * 1000ULL;
+    ax12_sim_stats.timeouts++;
+    return -1;
+  }
+  if(sim.tx_pos == 0) {
+    ax12_sim_stats.time_ns += sim.tx_delay_us * 1000ULL;
+  }
+  ax12_sim_byte_time();
+  const uint8_t v = sim.tx[sim.tx_pos++];
+  if(sim.tx_pos == sim.tx_len) {
+    ax12_sim_stats.replies++;
+  }
+  return v;
+}
+
+static void ax12_sim_set_state(ax12_state_t state)
+{
+  if(state == AX12_STATE_WRITE && sim.state != AX12_STATE_WRITE) {
+    // drop any pending reply and partial instruction packet
+    sim.tx_len = sim.tx_pos = 0;
+    sim.rx_len = 0;
+  }
+  sim.state = state;
+}
+
+ax12_t ax12_sim = {
+  .send = ax12_sim_send,
+  .recv = ax12_sim_recv,
+  .set_state = ax12_sim_set_state,
+  .recv_nowait = ax12_sim_recv,
+};
+
+
+void ax12_sim_init(uint32_t baudrate, uint32_t timeout_us)
+{
+  memset(&sim, 0, sizeof(sim));
+  sim.baudrate = baudrate;
+  sim.timeout_us = timeout_us;
+  sim.state = AX12_STATE_READ;
+  ax12_sim_reset_stats();
+}
+
+ax12_sim_servo_t *ax12_sim_add(uint8_t id)
+{
+  if(sim.nservos >= AX12_SIM_MAX_SERVOS) {
+    return NULL;
+  }
+  ax12_sim_servo_t *servo = &sim.servos[sim.nservos++];
+  ax12_sim_servo_reset(servo, id);
+  return servo;
+}
+
+ax12_sim_servo_t *ax12_sim_get(uint8_t id)
+{
+  for(uint8_t i=0; i<sim.nservos; i++) {
+    if(sim.servos[i].mem[AX12_ADDR_ID] == id) {
+      return &sim.servos[i];
+    }
+  }
+  return NULL;
+}
+
+void ax12_sim_reset_stats(void)
+{
+  memset(&ax12_sim_stats, 0, sizeof(ax12_sim_stats));
+}
+
+void ax12_sim_print_stats(FILE *fp, const char *name)
+{
+  const ax12_sim_stats_t *st = &ax12_sim_stats;
+  const double t = st->time_ns * 1e-9;
+  fprintf(fp, "%-24s %6lu instr %6lu replies %8.1f us %9.1f instr/s  occupancy %5.1f%%\n",
+          name, (unsigned long)st->instructions, (unsigned long)st->replies,
+          t * 1e6, t > 0 ? st->instructions / t : 0.,
+          t > 0 ? 100. * st->busy_ns / st->time_ns : 0.);
+}
+
+void ax12_sim_benchmark(FILE *fp, uint8_t n)
+{
+  uint8_t ids[AX12_SIM_MAX_SERVOS];
+  uint8_t data[2*AX12_SIM_MAX_SERVOS];
+  if(n > AX12_SIM_MAX_SERVOS) {
+    n = AX12_SIM_MAX_SERVOS;
+  }
+  for(uint8_t i=0; i<n; i++) {
+    ids[i] = i + 1;
+    data[2*i] = 0x00;
+    data[2*i+1] = 0x02;
+    if(!ax12_sim_get(ids[i])) {
+      ax12_sim_add(ids[i]);
+    }
+  }
+  fprintf(fp, "AX-12 bus benchmark: %u servos, %lu bit/s\n", n, (unsigned long)sim.baudrate);
+
+  ax12_sim_reset_stats();
+  for(uint8_t i=0; i<n; i++) {
+    ax12_write_word(&ax12_sim, ids[i], AX12_ADDR_GOAL_POSITION_L, 0x200);
+  }
+  ax12_sim_print_stats(fp, "write goal (WRITE)");
+
+  ax12_sim_reset_stats();
+  ax12_sync_write(&ax12_sim, AX12_ADDR_GOAL_POSITION_L, 2, n, ids, data);
+  ax12_sim_print_stats(fp, "write goal (SYNC_WRITE)");
+
+  ax12_sim_reset_stats();
+  for(uint8_t i=0; i<n; i++) {
+    ax12_reg_write_mem(&ax12_sim, ids[i], AX12_ADDR_GOAL_POSITION_L, 2, &data[2*i]);
+  }
+  ax12_action(&ax12_sim, AX12_BROADCAST_ID);
+  ax12_sim_print_stats(fp, "write goal (REG_WRITE)");
+
+  ax12_sim_reset_stats();
+  for(uint8_t i=0; i<n; i++) {
+    uint8_t state[8];
+    ax12_read_mem(&ax12_sim, ids[i], AX12_ADDR_PRESENT_POSITION_L, sizeof(state), state);
+  }
+  ax12_sim_print_stats(fp, "read present state");
+
+  ax12_sim_reset_stats();
+  for(uint8_t i=0; i<n; i++) {
+    ax12_ping(&ax12_sim, ids[i]);
+  }
+  ax12_sim_print_stats(fp, "ping");
+}
+
+#endif
+///@endcond
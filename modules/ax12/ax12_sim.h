@@ -0,0 +1,95 @@
+/** @addtogroup ax12 */
+//@{
+/** @file
+ * @brief AX-12 bus simulator (host only)
+ */
+/** @name Bus simulator
+ *
+ * The simulator implements the \ref ax12_t callbacks against virtual AX-12
+ * (Protocol 1.0). Bus time is simulated from the baudrate and the return
+ * delay of each AX-12, which allows to measure bus utilization of command
+ * patterns without hardware.
+ *
+ * Virtual AX-12 process PING, READ, WRITE, REG_WRITE, ACTION, RESET and
+ * SYNC_WRITE instructions, and honor their status return level. Present
+ * position immediately follows goal position.
+ *
+ * There is a single simulated bus.
+ *
+ * The \e tools/ax12_sim host program checks the simulator and runs
+ * ax12_sim_benchmark().
+ */
+//@{
+#ifndef AX12_SIM_H__
+#define AX12_SIM_H__
+
+#ifndef HOST_VERSION
+# error AX-12 bus simulator is only available on host
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include "ax12.h"
+
+/// Size of simulated AX-12 memory
+#define AX12_SIM_MEM_SIZE  (AX12_ADDR_PUNCH_H + 1)
+/// Maximum number of simulated AX-12
+#define AX12_SIM_MAX_SERVOS  32
+
+/// Simulated AX-12
+typedef struct {
+  uint8_t mem[AX12_SIM_MEM_SIZE];  ///< control table
+  uint8_t reg_addr;  ///< address of the registered write
+  uint8_t reg_len;  ///< size of the registered write, 0 if none
+  uint8_t reg_data[AX12_SIM_MEM_SIZE];  ///< data of the registered write
+
+} ax12_sim_servo_t;
+
+/// Bus statistics
+typedef struct {
+  uint32_t instructions;  ///< number of sent instruction packets
+  uint32_t replies;  ///< number of received status packets
+  uint32_t timeouts;  ///< number of receive timeouts
+  uint64_t time_ns;  ///< elapsed bus time
+  uint64_t busy_ns;  ///< time spent transmitting bytes
+
+} ax12_sim_stats_t;
+
+/// AX-12 interface of the simulated bus
+extern ax12_t ax12_sim;
+
+/// Statistics of the simulated bus
+extern ax12_sim_stats_t ax12_sim_stats;
+
+
+/** @brief Initialize the simulated bus
+ *
+ * @param baudrate  bus baudrate, in bit/s
+ * @param timeout_us  receive timeout, in microseconds
+ */
+void ax12_sim_init(uint32_t baudrate, uint32_t timeout_us);
+
+/** @brief Add a simulated AX-12 with default control table values
+ *
+ * Return NULL if there is no room left.
+ */
+ax12_sim_servo_t *ax12_sim_add(uint8_t id);
+
+/// Get a simulated AX-12 by ID, NULL if not found
+ax12_sim_servo_t *ax12_sim_get(uint8_t id);
+
+/// Reset bus statistics
+void ax12_sim_reset_stats(void);
+
+/// Print bus statistics: transactions per second, bus occupancy
+void ax12_sim_print_stats(FILE *fp, const char *name);
+
+/** @brief Run typical command patterns and print their statistics
+ *
+ * Simulated AX-12 with IDs 1 to \e n are used, they are added if needed.
+ */
+void ax12_sim_benchmark(FILE *fp, uint8_t n);
+
+#endif
+//@}
+//@}
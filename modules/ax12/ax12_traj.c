@@ -0,0 +1,135 @@
+/**
+ * @cond internal
+ * @file
+ */
+#include "ax12.h"
+// Don't attempt to define anything if trajectory players are disabled
+#ifdef AX12_TRAJ_PERIOD_US
+
+#include "ax12_traj.h"
+
+
+bool ax12_traj_init(ax12_traj_t *traj, ax12_async_t *a, uint8_t nservos, const uint8_t *ids)
+{
+  traj->async = a;
+  traj->ids = ids;
+  traj->running = false;
+  traj->queued = false;
+  traj->error = 0;
+  if(nservos > AX12_TRAJ_MAX_SERVOS) {
+    traj->nservos = 0;
+    return false;
+  }
+  traj->nservos = nservos;
+  return true;
+}
+
+
+void ax12_traj_start(ax12_traj_t *traj, uint8_t nkeys, const uint16_t *times, const uint16_t *positions)
+{
+  // ticks ignore the player while it is being set up
+  traj->running = false;
+  if(nkeys == 0) {
+    return;
+  }
+  traj->nkeys = nkeys;
+  traj->times = times;
+  traj->positions = positions;
+  traj->key = 0;
+  traj->elapsed_us = 0;
+  traj->running = true;
+}
+
+
+void ax12_traj_stop(ax12_traj_t *traj)
+{
+  traj->running = false;
+}
+
+
+bool ax12_traj_running(const ax12_traj_t *traj)
+{
+  return traj->running || traj->queued;
+}
+
+
+uint8_t ax12_traj_error(const ax12_traj_t *traj)
+{
+  return traj->error;
+}
+
+
+/// Completion callback of sent goal positions
+static void ax12_traj_sent(ax12_async_t *a, const ax12_async_xfer_t *xfer)
+{
+  (void)a;
+  ax12_traj_t *traj = xfer->arg;
+  traj->error = xfer->error;
+  traj->queued = false;
+}
+
+/** @brief Compute goal positions of the current tick
+ *
+ * Return true if the last keyframe has been reached.
+ */
+static bool ax12_traj_compute(ax12_traj_t *traj)
+{
+  const uint32_t t = traj->elapsed_us;
+  traj->elapsed_us += AX12_TRAJ_PERIOD_US;
+
+  // advance to the segment containing t
+  while(traj->key + 1 < traj->nkeys && t >= traj->times[traj->key+1] * 1000UL) {
+    traj->key++;
+  }
+
+  const uint8_t n = traj->nservos;
+  const uint16_t *p0 = &traj->positions[traj->key * n];
+  uint8_t *data = traj->goals;
+
+  if(traj->key + 1 >= traj->nkeys) {
+    // last keyframe reached
+    for(uint8_t i=0; i<n; i++) {
+      data[2*i] = p0[i] & 0xFF;
+      data[2*i+1] = p0[i] >> 8;
+    }
+    return true;
+  } else {
+    const uint16_t *p1 = p0 + n;
+    const uint32_t t0 = traj->times[traj->key] * 1000UL;
+    const uint32_t t1 = traj->times[traj->key+1] * 1000UL;
+    // progress in the segment, 10-bit fixed point (one division per tick)
+    // durations are counted in 256us units to avoid overflows
+    const uint32_t den = (t1 - t0) >> 8;
+    const int32_t frac = (t <= t0 || den == 0) ? 0 : (((t - t0) >> 8) << 10) / den;
+    for(uint8_t i=0; i<n; i++) {
+      const int32_t delta = (int32_t)p1[i] - p0[i];
+      const uint16_t pos = p0[i] + (int16_t)((delta * frac) >> 10);
+      data[2*i] = pos & 0xFF;
+      data[2*i+1] = pos >> 8;
+    }
+    return false;
+  }
+}
+
+
+void ax12_traj_tick(ax12_traj_t *traj)
+{
+  if(traj->running) {
+    // queued positions are read when sent, they can be updated until then
+    const bool last = ax12_traj_compute(traj);
+    if(!traj->queued) {
+      traj->queued = ax12_async_submit_sync_write(
+          traj->async, AX12_ADDR_GOAL_POSITION_L, 2, traj->nservos,
+          traj->ids, traj->goals, ax12_traj_sent, traj);
+    }
+    // if the queue is full, last positions are queued by the next tick
+    if(last && traj->queued) {
+      traj->running = false;
+    }
+  }
+  ax12_async_update(traj->async);
+}
+
+
+#endif
+///@endcond
@@ -0,0 +1,112 @@
+/** @addtogroup ax12 */
+//@{
+/** @file
+ * @brief AX-12 trajectory player
+ */
+/** @name Trajectory player
+ *
+ * A trajectory player interpolates goal positions of a set of AX-12 between
+ * timestamped keyframes. Goal positions of all AX-12 are sent in a single
+ * SYNC_WRITE packet.
+ *
+ * Ticks are meant to be run from a timer callback, so that positions are sent
+ * evenly spaced. Each tick queues a SYNC_WRITE on an asynchronous transaction
+ * engine and updates it: positions are sent from the tick, which only blocks
+ * for the packet TX. For instance:
+ * @code
+ * static ax12_async_t async;
+ * static ax12_traj_t traj;
+ * static void traj_tick(void) { ax12_traj_tick(&traj); }
+ * ax12_async_init(&async, &ax12);
+ * ax12_traj_init(&traj, &async, nservos, ids);
+ * timer_set_callback_us(E0, TIMER_CHB, AX12_TRAJ_PERIOD_US, INTLVL_LO, traj_tick);
+ * @endcode
+ *
+ * The player owns the bus: while a trajectory is being played (see
+ * ax12_traj_running()), the main loop must not use the bus synchronously.
+ * Other transactions can be submitted to the engine; they are processed by
+ * ticks, and \ref AX12_ASYNC_INTLVL must then be set to the tick level.
+ * ax12_async_update() must not be called from another context.
+ *
+ * If the previous positions are still queued when a tick runs (for instance
+ * behind a transaction waiting for a reply), they are replaced by the new
+ * ones.
+ */
+//@{
+#ifndef AX12_TRAJ_H__
+#define AX12_TRAJ_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ax12.h"
+#include "ax12_async.h"
+
+#ifndef AX12_TRAJ_PERIOD_US
+# error AX12_TRAJ_PERIOD_US must be defined to use trajectory players
+#endif
+
+/// Maximum number of AX-12 of a trajectory player
+#define AX12_TRAJ_MAX_SERVOS  16
+
+
+/// AX-12 trajectory player
+typedef struct {
+  ax12_async_t *async;  ///< asynchronous engine used to send positions
+  uint8_t nservos;  ///< number of AX-12
+  const uint8_t *ids;  ///< IDs of the AX-12
+  uint8_t nkeys;  ///< number of keyframes
+  const uint16_t *times;  ///< keyframe times, in milliseconds
+  const uint16_t *positions;  ///< keyframe positions, \e nservos values per keyframe
+  uint8_t key;  ///< index of the current keyframe
+  uint32_t elapsed_us;  ///< time elapsed since start
+  volatile bool running;  ///< true if a trajectory is being played
+  volatile bool queued;  ///< true if goal positions are queued on the engine
+  uint8_t error;  ///< error of the last sent positions
+  uint8_t goals[2*AX12_TRAJ_MAX_SERVOS];  ///< goal positions to send
+} ax12_traj_t;
+
+
+/** @brief Initialize a trajectory player
+ *
+ * \e ids must remain valid.
+ *
+ * Return false if \e nservos is larger than \ref AX12_TRAJ_MAX_SERVOS. The
+ * player is then left without AX-12.
+ */
+bool ax12_traj_init(ax12_traj_t *traj, ax12_async_t *a, uint8_t nservos, const uint8_t *ids);
+
+/** @brief Start playing a trajectory
+ *
+ * @param nkeys  number of keyframes
+ * @param times  keyframe times since start, in milliseconds, increasing
+ * @param positions  goal positions, \e nservos values per keyframe
+ *
+ * Arrays must remain valid while the trajectory is played. Positions of the
+ * first keyframe are held until its time.
+ */
+void ax12_traj_start(ax12_traj_t *traj, uint8_t nkeys, const uint16_t *times, const uint16_t *positions);
+
+/// Stop playing the current trajectory
+void ax12_traj_stop(ax12_traj_t *traj);
+
+/** @brief Return true if a trajectory is being played
+ *
+ * Positions of the last keyframe are considered played once sent. The bus
+ * is owned by the player until then.
+ */
+bool ax12_traj_running(const ax12_traj_t *traj);
+
+/** @brief Compute and send goal positions
+ *
+ * Must be called every \ref AX12_TRAJ_PERIOD_US, even when no trajectory is
+ * played. Goal positions are queued on the engine, which is then updated.
+ * The trajectory stops once the time of the last keyframe is reached.
+ */
+void ax12_traj_tick(ax12_traj_t *traj);
+
+/// Return the error of the last sent goal positions
+uint8_t ax12_traj_error(const ax12_traj_t *traj);
+
+#endif
+//@}
+//@}
@@ -1 +1,7 @@
-SRCS = ax12.c
+SRCS = ax12.c ax12_p2.c ax12_async.c ax12_shadow.c ax12_poll.c ax12_traj.c ax12_sim.c
+MODULES =
+
+# asynchronous transactions require uptime
+ifneq ($(shell grep -sE '^\s*\#\s*define\s+AX12_ASYNC_QUEUE_SIZE\b' ax12_config.h),)
+MODULES += timer
+endif
@@ -12,5 +12,48 @@
  */
 #define AX12_MAX_PARAMS 16
 
+/** @brief Size of the asynchronous transaction queue
+ *
+ * If set, asynchronous transactions are available (see ax12_async.h).
+ *
+ * @note The \e timer module is then required, with uptime configured.
+ */
+#undef AX12_ASYNC_QUEUE_SIZE
+
+/// Reply timeout of asynchronous transactions, in microseconds
+#define AX12_ASYNC_REPLY_TIMEOUT_US  2000
+
+/** @brief Interrupt level of ax12_async_update() calls
+ *
+ * If set, this level is disabled when modifying the transaction queue from
+ * another context.
+ */
+#undef AX12_ASYNC_INTLVL
+
+/** @brief First address of the shadowed control table range
+ *
+ * If set, register shadows are available (see ax12_shadow.h).
+ * For instance, \ref AX12_ADDR_TORQUE_ENABLE.
+ */
+#undef AX12_SHADOW_ADDR_START
+
+/// Last address of the shadowed control table range, at most 16 bytes
+#define AX12_SHADOW_ADDR_END  AX12_ADDR_TORQUE_LIMIT_H
+
+/** @brief Maximum number of polled AX-12
+ *
+ * If set, state polling is available (see ax12_poll.h).
+ */
+#undef AX12_POLL_SIZE
+
+/** @brief Period of trajectory player ticks, in microseconds
+ *
+ * If set, trajectory players are available (see ax12_traj.h).
+ * Asynchronous transactions are required (see \ref AX12_ASYNC_QUEUE_SIZE).
+ * ax12_traj_tick() must be called with this period, typically from a timer
+ * callback. For instance, 20000.
+ */
+#undef AX12_TRAJ_PERIOD_US
+
 //@}
 //@}
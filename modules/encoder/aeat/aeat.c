@@ -12,6 +12,25 @@
 # error AEAT_SPI_PRESCALER is too low, max AEAT SPI frequency is 1MHz
 #endif
 
+#ifdef AEAT_ASYNC_INTLVL
+
+// Indirection to build the SPI interrupt vector name
+#define AEAT_SPI_INT_vect_(spi)  spi##_INT_vect
+#define AEAT_SPI_INT_vect_x(spi)  AEAT_SPI_INT_vect_(spi)
+#define AEAT_SPI_INT_vect  AEAT_SPI_INT_vect_x(AEAT_SPI)
+
+/// Asynchronous read state
+static struct {
+  aeat_t *encs[AEAT_ASYNC_MAX];  ///< encoders to read
+  uint8_t n;  ///< number of encoders to read, 0 if no read is in progress
+  uint8_t current;  ///< index of the encoder being read
+  uint8_t msb;  ///< received MSB of the current encoder
+  bool lsb;  ///< true if waiting for the LSB
+  aeat_async_callback_t cb;  ///< callback called at the end of the read
+} volatile async;
+
+#endif
+
 
 void aeat_spi_init(void)
 {
@@ -61,8 +80,13 @@ static inline uint8_t aeat_spi_recv(void)
 }
 
 
-void aeat_update(aeat_t *enc)
+uint16_t aeat_capture(aeat_t *enc)
 {
+#ifdef AEAT_ASYNC_INTLVL
+  // the SPI is used by the asynchronous read, wait for its end
+  while(async.n != 0) ;
+#endif
+
   // select the SPI slave
   portpin_outclr(&enc->cspp);
 
@@ -73,19 +97,98 @@ void aeat_update(aeat_t *enc)
 
   // deselect the SPI slave
   portpin_outset(&enc->cspp);
+  return capture;
+}
+
 
+int32_t aeat_update_capture(aeat_t *enc, uint16_t capture)
+{
   // update encoder state
   uint16_t diff = (capture - enc->capture) & 0xfff;
   enc->capture = capture;
+  if(diff & 0x800) {
+    enc->value -= 0x1000-diff;
+  } else {
+    enc->value += diff;
+  }
+  return enc->value;
+}
+
+
+void aeat_update(aeat_t *enc)
+{
+  uint16_t capture = aeat_capture(enc);
   INTLVL_DISABLE_BLOCK(INTLVL_HI) {
-    if(diff & 0x800) {
-      enc->value -= 0x1000-diff;
-    } else {
-      enc->value += diff;
+    aeat_update_capture(enc, capture);
+  }
+}
+
+
+#ifdef AEAT_ASYNC_INTLVL
+
+bool aeat_async_update(aeat_t *const *encs, uint8_t n, aeat_async_callback_t cb)
+{
+  if(n == 0 || n > AEAT_ASYNC_MAX) {
+    return false;
+  }
+  INTLVL_DISABLE_ALL_BLOCK() {
+    if(async.n != 0) {
+      return false;
+    }
+    for(uint8_t i=0; i<n; i++) {
+      async.encs[i] = encs[i];
     }
+    async.n = n;
+    async.current = 0;
+    async.lsb = false;
+    async.cb = cb;
+    AEAT_SPI.INTCTRL = AEAT_ASYNC_INTLVL;
+    portpin_outclr(&encs[0]->cspp);
+    AEAT_SPI.DATA = 0;
   }
+  return true;
+}
+
+bool aeat_async_busy(void)
+{
+  return async.n != 0;
 }
 
+/// Interrupt handler for asynchronous reads
+ISR(AEAT_SPI_INT_vect)
+{
+  uint8_t data = ~AEAT_SPI.DATA;
+  if(!async.lsb) {
+    async.msb = data;
+    async.lsb = true;
+    AEAT_SPI.DATA = 0;
+    return;
+  }
+
+  aeat_t *enc = async.encs[async.current];
+  portpin_outset(&enc->cspp);
+  uint16_t capture = (((uint16_t)async.msb << 8) | data) >> 3;
+  INTLVL_DISABLE_BLOCK(INTLVL_HI) {
+    aeat_update_capture(enc, capture);
+  }
+
+  if(++async.current < async.n) {
+    // next encoder
+    async.lsb = false;
+    portpin_outclr(&async.encs[async.current]->cspp);
+    AEAT_SPI.DATA = 0;
+  } else {
+    // last encoder, end the read
+    AEAT_SPI.INTCTRL = 0;
+    async.n = 0;
+    if(async.cb) {
+      async.cb();
+    }
+  }
+}
+
+#endif
+
 
 int32_t aeat_get_value(aeat_t *enc)
 {
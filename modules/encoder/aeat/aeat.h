@@ -11,7 +11,9 @@
 
 #include <avr/io.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <avarix/portpin.h>
+#include "aeat_config.h"
 
 
 /** @brief AEAT encoder data
@@ -38,9 +40,61 @@ void aeat_spi_init(void);
  */
 void aeat_init(aeat_t *enc, portpin_t cspp);
 
-/// Update encoder value, should be called often
+/** @brief Update encoder value, should be called often
+ *
+ * The position is read with \ref aeat_capture().
+ */
 void aeat_update(aeat_t *enc);
 
+/** @brief Read the encoder position, for \ref aeat_update_capture()
+ *
+ * Capturing positions of several encoders then updating them allows to
+ * publish them together.
+ *
+ * If \ref AEAT_ASYNC_INTLVL is defined and an asynchronous read is in
+ * progress, wait for its end, since the SPI is shared by all encoders. It must
+ * then not be called from an interrupt of level \ref AEAT_ASYNC_INTLVL or
+ * higher.
+ */
+uint16_t aeat_capture(aeat_t *enc);
+
+/** @brief Update encoder value from a captured position
+ *
+ * Encoder value is not protected, the caller must disable interrupts of level
+ * \e INTLVL_HI and lower. Return the updated value.
+ */
+int32_t aeat_update_capture(aeat_t *enc, uint16_t capture);
+
+#if (defined DOXYGEN) || (defined AEAT_ASYNC_INTLVL)
+
+/// Callback called at the end of an asynchronous read
+typedef void (*aeat_async_callback_t)(void);
+
+/** @brief Start an asynchronous read of several encoders
+ *
+ * @param encs  encoders to read, in order
+ * @param n  number of encoders, at most \ref AEAT_ASYNC_MAX
+ * @param cb  callback called from the interrupt handler once all encoders
+ *            have been updated, or NULL
+ *
+ * Encoders are read one after the other, using SPI interrupts. Each encoder
+ * value is updated as soon as its position has been received.
+ *
+ * The SPI is shared by all encoders and is used exclusively by the read until
+ * it ends (see \ref aeat_async_busy()). Synchronous reads of any encoder
+ * (\ref aeat_capture(), \ref aeat_update()) wait for the end of the read.
+ * A read must not be started from an interrupt which may preempt a
+ * synchronous read.
+ *
+ * Return false if a read is already in progress.
+ */
+bool aeat_async_update(aeat_t *const *encs, uint8_t n, aeat_async_callback_t cb);
+
+/// Return true if an asynchronous read is in progress
+bool aeat_async_busy(void);
+
+#endif
+
 /// Get current encoder value
 int32_t aeat_get_value(aeat_t *enc);
 
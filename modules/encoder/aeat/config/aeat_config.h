@@ -14,6 +14,15 @@
 /// SPI prescaler factor (2, 4, 8, 16, 32, 64 or 128)
 #define AEAT_SPI_PRESCALER  16
 
+/** @brief Interrupt level of asynchronous reads
+ *
+ * If defined, encoders can be read asynchronously, using SPI interrupts.
+ */
+#undef AEAT_ASYNC_INTLVL
+
+/// Maximum number of encoders read by an asynchronous sequence
+#define AEAT_ASYNC_MAX  4
+
 
 //@}
 //@}
@@ -0,0 +1,2 @@
+SRCS = group.c
+MODULES = encoder/quadra encoder/aeat
@@ -0,0 +1,19 @@
+/** @addtogroup encoder_group */
+//@{
+/** @file
+ * @brief Encoder group configuration
+ */
+/** @name Configuration
+ */
+//@{
+
+
+/// Maximum number of quadrature encoders in a group
+#define ENCODER_GROUP_QUADRA_MAX  2
+
+/// Maximum number of AEAT encoders in a group
+#define ENCODER_GROUP_AEAT_MAX  2
+
+
+//@}
+//@}
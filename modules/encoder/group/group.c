@@ -0,0 +1,80 @@
+/**
+ * @cond internal
+ * @file
+ */
+#include <avarix/intlvl.h>
+#include "group.h"
+
+
+void encoder_group_init(encoder_group_t *grp, TC0_t *tc)
+{
+  grp->tc = tc;
+  grp->nquadras = 0;
+  grp->naeats = 0;
+  grp->snapshot.time = 0;
+}
+
+
+bool encoder_group_add_quadra(encoder_group_t *grp, quadra_t *enc)
+{
+  if(grp->nquadras == ENCODER_GROUP_QUADRA_MAX) {
+    return false;
+  }
+  grp->snapshot.quadra[grp->nquadras] = quadra_get_value(enc);
+  grp->quadras[grp->nquadras++] = enc;
+  return true;
+}
+
+
+bool encoder_group_add_aeat(encoder_group_t *grp, aeat_t *enc)
+{
+  if(grp->naeats == ENCODER_GROUP_AEAT_MAX) {
+    return false;
+  }
+  grp->snapshot.aeat[grp->naeats] = aeat_get_value(enc);
+  grp->aeats[grp->naeats++] = enc;
+  return true;
+}
+
+
+void encoder_group_update(encoder_group_t *grp)
+{
+  uint32_t quadra_captures[ENCODER_GROUP_QUADRA_MAX];
+  uint16_t aeat_captures[ENCODER_GROUP_AEAT_MAX];
+  uint16_t time;
+
+  // latch quadrature counters, as close as possible
+  INTLVL_DISABLE_ALL_BLOCK() {
+    time = grp->tc->CNT;
+    for(uint8_t i=0; i<grp->nquadras; i++) {
+      quadra_captures[i] = quadra_capture(grp->quadras[i]);
+    }
+  }
+
+  // read AEAT encoders in a single sweep
+  for(uint8_t i=0; i<grp->naeats; i++) {
+    aeat_captures[i] = aeat_capture(grp->aeats[i]);
+  }
+
+  // update encoders and publish the snapshot
+  INTLVL_DISABLE_BLOCK(INTLVL_HI) {
+    for(uint8_t i=0; i<grp->nquadras; i++) {
+      grp->snapshot.quadra[i] = quadra_update_capture(grp->quadras[i], quadra_captures[i]);
+    }
+    for(uint8_t i=0; i<grp->naeats; i++) {
+      grp->snapshot.aeat[i] = aeat_update_capture(grp->aeats[i], aeat_captures[i]);
+    }
+    grp->snapshot.time = time;
+  }
+}
+
+
+void encoder_group_get_snapshot(encoder_group_t *grp, encoder_group_snapshot_t *snapshot)
+{
+  INTLVL_DISABLE_BLOCK(INTLVL_HI) {
+    *snapshot = grp->snapshot;
+  }
+}
+
+
+///@endcond
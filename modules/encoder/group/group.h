@@ -0,0 +1,85 @@
+/** @defgroup encoder_group Encoder group
+ * @brief Sample several encoders together
+ *
+ * Updating encoders one after another samples them at different times.
+ * A group samples all its encoders at once and publishes a consistent
+ * snapshot of their values, with a single timestamp.
+ *
+ * Quadrature counters are latched back-to-back, with interrupts disabled.
+ * AEAT encoders are then read in a single SPI sweep. Finally, encoder values
+ * and the snapshot are updated under a single lock.
+ *
+ * Encoders of a group must not be updated individually.
+ *
+ * AEAT encoders are read synchronously: if an asynchronous AEAT read is in
+ * progress, \ref encoder_group_update() waits for its end.
+ */
+//@{
+/**
+ * @file
+ * @brief Encoder group definitions
+ */
+#ifndef ENCODER_GROUP_H__
+#define ENCODER_GROUP_H__
+
+#include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <encoder/quadra/quadra.h>
+#include <encoder/aeat/aeat.h>
+#include "group_config.h"
+
+
+/// Values of a group's encoders, sampled together
+typedef struct {
+  uint16_t time;  ///< timer value when quadrature counters have been latched
+  int32_t quadra[ENCODER_GROUP_QUADRA_MAX];  ///< quadrature encoder values
+  int32_t aeat[ENCODER_GROUP_AEAT_MAX];  ///< AEAT encoder values
+} encoder_group_snapshot_t;
+
+/** @brief Encoder group
+ * @note Fields are private and should not be accessed directly.
+ */
+typedef struct {
+  TC0_t *tc;  ///< timer used to timestamp snapshots
+  quadra_t *quadras[ENCODER_GROUP_QUADRA_MAX];  ///< quadrature encoders
+  uint8_t nquadras;  ///< number of quadrature encoders
+  aeat_t *aeats[ENCODER_GROUP_AEAT_MAX];  ///< AEAT encoders
+  uint8_t naeats;  ///< number of AEAT encoders
+  encoder_group_snapshot_t snapshot;  ///< last published snapshot
+} encoder_group_t;
+
+
+/** @brief Initialize an encoder group
+ *
+ * @param grp  group to initialize
+ * @param tc  running timer used to timestamp snapshots (can also be a
+ *            pointer to a \e TC1_t)
+ *
+ * The timer is not configured by the module.
+ */
+void encoder_group_init(encoder_group_t *grp, TC0_t *tc);
+
+/** @brief Add an initialized quadrature encoder to a group
+ *
+ * Its index in snapshots is the number of previously added quadrature
+ * encoders. Return false if the group is full.
+ */
+bool encoder_group_add_quadra(encoder_group_t *grp, quadra_t *enc);
+
+/** @brief Add an initialized AEAT encoder to a group
+ *
+ * Its index in snapshots is the number of previously added AEAT encoders.
+ * Return false if the group is full.
+ */
+bool encoder_group_add_aeat(encoder_group_t *grp, aeat_t *enc);
+
+/// Sample all encoders and publish a new snapshot, should be called often
+void encoder_group_update(encoder_group_t *grp);
+
+/// Get the last published snapshot
+void encoder_group_get_snapshot(encoder_group_t *grp, encoder_group_snapshot_t *snapshot);
+
+
+#endif
+//@}
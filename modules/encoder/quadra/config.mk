@@ -1 +1,2 @@
 SRCS = quadra.c
+MODULES = clock
@@ -0,0 +1,34 @@
+/** @addtogroup quadra */
+//@{
+/** @file
+ * @brief Quadrature encoders configuration
+ */
+/** @name Configuration
+ *
+ * Counters of quadrature timers can be extended to 32 bits by defining
+ * \ref QUADRA_TCxn_EXTENDED for each timer.
+ * Counter overflows are then counted by an interrupt handler, so that no
+ * count is lost, no matter how rarely \ref quadra_update() is called.
+ *
+ * Since the timer has a single overflow flag, the direction of a wrap is
+ * deduced from the counter value when the overflow is handled: below 0x8000
+ * after counting up, above after counting down. The extended value is off by
+ * 65536 counts if, before the overflow is handled, the counter moves by 32768
+ * counts or more past the wrap, or wraps back in the opposite direction.
+ * The overflow interrupt level must be high enough for this not to happen,
+ * including while interrupts are disabled by other modules. Extended counters
+ * start at 0x8000, so that the wrap is away from the initial position.
+ *
+ * This file is optional, extended counters are disabled without it.
+ */
+//@{
+
+/// Extend TCxn counter to 32 bits
+#define QUADRA_TCxn_EXTENDED
+
+/// Interrupt level of counter overflows
+#define QUADRA_EXTENDED_INTLVL  INTLVL_HI
+
+
+//@}
+//@}
@@ -2,8 +2,88 @@
  * @cond internal
  * @file
  */
+#include <avr/interrupt.h>
+#include <clock/defs.h>
 #include "quadra.h"
 
+#ifndef QUADRA_EXTENDED_INTLVL
+# define QUADRA_EXTENDED_INTLVL  INTLVL_HI
+#endif
+
+/// Homing states
+enum {
+  QUADRA_HOME_NONE = 0,  ///< no homing
+  QUADRA_HOME_ARMED,  ///< waiting for the index
+  QUADRA_HOME_LATCHED,  ///< index captured, value not updated yet
+  QUADRA_HOME_DONE,  ///< homing done
+};
+
+#ifdef QUADRA_TCC0_EXTENDED
+# define QUADRA_TCC0_APPLY_EXPR(f)  f(C0)
+#else
+# define QUADRA_TCC0_APPLY_EXPR(f)
+#endif
+
+#ifdef QUADRA_TCC1_EXTENDED
+# define QUADRA_TCC1_APPLY_EXPR(f)  f(C1)
+#else
+# define QUADRA_TCC1_APPLY_EXPR(f)
+#endif
+
+#ifdef QUADRA_TCD0_EXTENDED
+# define QUADRA_TCD0_APPLY_EXPR(f)  f(D0)
+#else
+# define QUADRA_TCD0_APPLY_EXPR(f)
+#endif
+
+#ifdef QUADRA_TCD1_EXTENDED
+# define QUADRA_TCD1_APPLY_EXPR(f)  f(D1)
+#else
+# define QUADRA_TCD1_APPLY_EXPR(f)
+#endif
+
+#ifdef QUADRA_TCE0_EXTENDED
+# define QUADRA_TCE0_APPLY_EXPR(f)  f(E0)
+#else
+# define QUADRA_TCE0_APPLY_EXPR(f)
+#endif
+
+#ifdef QUADRA_TCE1_EXTENDED
+# define QUADRA_TCE1_APPLY_EXPR(f)  f(E1)
+#else
+# define QUADRA_TCE1_APPLY_EXPR(f)
+#endif
+
+#ifdef QUADRA_TCF0_EXTENDED
+# define QUADRA_TCF0_APPLY_EXPR(f)  f(F0)
+#else
+# define QUADRA_TCF0_APPLY_EXPR(f)
+#endif
+
+#ifdef QUADRA_TCF1_EXTENDED
+# define QUADRA_TCF1_APPLY_EXPR(f)  f(F1)
+#else
+# define QUADRA_TCF1_APPLY_EXPR(f)
+#endif
+
+// Apply a macro to all extended timers
+#define QUADRA_EXTENDED_APPLY_EXPR(f)  \
+  QUADRA_TCC0_APPLY_EXPR(f) \
+  QUADRA_TCC1_APPLY_EXPR(f) \
+  QUADRA_TCD0_APPLY_EXPR(f) \
+  QUADRA_TCD1_APPLY_EXPR(f) \
+  QUADRA_TCE0_APPLY_EXPR(f) \
+  QUADRA_TCE1_APPLY_EXPR(f) \
+  QUADRA_TCF0_APPLY_EXPR(f) \
+  QUADRA_TCF1_APPLY_EXPR(f) \
+
+
+// Encoders of extended timers
+#define QUADRA_EXPR(xn) \
+  static quadra_t *quadra_extended_##xn;
+QUADRA_EXTENDED_APPLY_EXPR(QUADRA_EXPR)
+#undef QUADRA_EXPR
+
 
 void quadra_init(quadra_t *enc, TC1_t *tc, uint8_t evch, portpin_t pp0, portpin_t pp90, uint8_t samples)
 {
@@ -11,6 +91,10 @@ void quadra_init(quadra_t *enc, TC1_t *tc, uint8_t evch, portpin_t pp0, portpin_
   enc->tc = tc;
   enc->capture = 0;
   enc->value = 0;
+  enc->vtc = 0;
+  enc->extended = false;
+  enc->high = 0;
+  enc->home_state = QUADRA_HOME_NONE;
 
   // configure input pins
   portpin_dirclr(&pp0);
@@ -24,23 +108,202 @@ void quadra_init(quadra_t *enc, TC1_t *tc, uint8_t evch, portpin_t pp0, portpin_
   tc->CTRLD = TC_EVACT_QDEC_gc | (TC_CLKSEL_EVCH0_gc + evch);
   tc->PER = 0xFFFF;
   tc->CTRLA = TC_CLKSEL_DIV1_gc;
+
+  // count overflows of extended timers
+#define QUADRA_EXPR(xn) \
+  if(tc == (TC1_t *)&TC##xn) { \
+    quadra_extended_##xn = enc; \
+    enc->extended = true; \
+  }
+  QUADRA_EXTENDED_APPLY_EXPR(QUADRA_EXPR)
+#undef QUADRA_EXPR
+  if(enc->extended) {
+    // start away from the wrap, the encoder may jitter around its position
+    tc->CNT = 0x8000;
+    enc->capture = 0x8000;
+    tc->INTFLAGS = TC1_OVFIF_bm;
+    tc->INTCTRLA = QUADRA_EXTENDED_INTLVL;
+  }
 }
 
 
-void quadra_update(quadra_t *enc)
+/// Count an overflow of an extended timer
+static void quadra_overflow(quadra_t *enc)
+{
+  // direction is given by the counter value after the wrap
+  if(enc->tc->CNT < 0x8000) {
+    enc->high++;
+  } else {
+    enc->high--;
+  }
+}
+
+#define QUADRA_EXPR(xn) \
+  ISR(TC##xn##_OVF_vect) { quadra_overflow(quadra_extended_##xn); }
+QUADRA_EXTENDED_APPLY_EXPR(QUADRA_EXPR)
+#undef QUADRA_EXPR
+
+
+void quadra_init_velocity(quadra_t *enc, TC1_t *tc, uint8_t evch, portpin_t ppe, uint16_t div, uint8_t samples)
+{
+  uint8_t clksel;
+  switch(div) {
+    case 1: clksel = TC_CLKSEL_DIV1_gc; break;
+    case 2: clksel = TC_CLKSEL_DIV2_gc; break;
+    case 4: clksel = TC_CLKSEL_DIV4_gc; break;
+    case 8: clksel = TC_CLKSEL_DIV8_gc; break;
+    case 64: clksel = TC_CLKSEL_DIV64_gc; break;
+    case 256: clksel = TC_CLKSEL_DIV256_gc; break;
+    case 1024: clksel = TC_CLKSEL_DIV1024_gc; break;
+    default: return;  // invalid prescaler
+  }
+
+  enc->vdiv = div;
+  enc->edge_valid = false;
+  enc->cap_edge = false;
+  enc->vel_count = 0;
+  enc->vel_time = 1;
+
+  // decoder pins sense levels, edges are sensed on a separate pin
+  portpin_dirclr(&ppe);
+  PORTPIN_CTRL(&ppe) = (PORTPIN_CTRL(&ppe) & ~PORT_ISC_gm) | PORT_ISC_RISING_gc;
+
+  // route the reference signal on its own event channel, without QDEC
+  (&EVSYS.CH0MUX)[evch] = PORTPIN_EVSYS_CHMUX(&ppe);
+  (&EVSYS.CH0CTRL)[evch] = samples - 1;
+
+  // capture edges on channel A, the timer runs freely
+  tc->CTRLA = TC_CLKSEL_OFF_gc;
+  tc->CTRLB = TC1_CCAEN_bm;
+  tc->CTRLD = TC_EVACT_CAPT_gc | (TC_EVSEL_CH0_gc + evch);
+  tc->PER = 0xFFFF;
+  tc->CNT = 0;
+  tc->INTFLAGS = TC1_CCAIF_bm;
+  tc->CTRLA = clksel;
+  enc->vtc = tc;
+}
+
+
+/// Read captured edges, return true if there is a new one
+static bool quadra_read_edge(TC1_t *vtc, uint16_t *edge_time)
+{
+  // captures are buffered, read them all to get the last one
+  bool edge = false;
+  while(vtc->INTFLAGS & TC1_CCAIF_bm) {
+    *edge_time = vtc->CCA;
+    edge = true;
+  }
+  return edge;
+}
+
+/// Update velocity after an update of the encoder value
+static void quadra_update_velocity(quadra_t *enc, int32_t value, bool edge, uint16_t edge_time, uint16_t now)
+{
+  if(edge) {
+    if(enc->edge_valid) {
+      uint16_t dt = edge_time - enc->edge_time;
+      if(dt != 0 && dt < QUADRA_VELOCITY_TIMEOUT) {
+        enc->vel_count = value - enc->edge_value;
+        enc->vel_time = dt;
+      } else {
+        enc->vel_count = 0;
+      }
+    }
+    enc->edge_valid = true;
+    enc->edge_time = edge_time;
+    enc->edge_value = value;
+  } else if(enc->edge_valid) {
+    uint16_t elapsed = now - enc->edge_time;
+    if(elapsed >= QUADRA_VELOCITY_TIMEOUT) {
+      // too slow, or stopped
+      enc->vel_count = 0;
+      enc->edge_valid = false;
+    } else if(elapsed > enc->vel_time) {
+      // next edge is late, velocity is lower than the last measurement
+      enc->vel_time = elapsed;
+    }
+  }
+}
+
+
+/// Capture the counter value, without reading edges
+static uint32_t quadra_capture_counter(quadra_t *enc)
+{
+  if(!enc->extended) {
+    return enc->tc->CNT;
+  }
+  uint16_t high, cnt;
+  INTLVL_DISABLE_ALL_BLOCK() {
+    high = enc->high;
+    cnt = enc->tc->CNT;
+    if(enc->tc->INTFLAGS & TC1_OVFIF_bm) {
+      // overflow not counted yet, read the counter after it
+      cnt = enc->tc->CNT;
+      high += cnt < 0x8000 ? 1 : -1;
+    }
+  }
+  return ((uint32_t)high << 16) | cnt;
+}
+
+uint32_t quadra_capture(quadra_t *enc)
 {
-  // capture a new value
-  uint16_t capture = enc->tc->CNT;
+  TC1_t *vtc = enc->vtc;
+  if(vtc) {
+    // edges are read before the counter, so that their counts are included
+    uint16_t edge_time = 0;
+    enc->cap_time = vtc->CNT;
+    enc->cap_edge = quadra_read_edge(vtc, &edge_time);
+    enc->cap_edge_time = edge_time;
+  }
+  return quadra_capture_counter(enc);
+}
+
 
-  // update encoder state
-  uint16_t diff = capture - enc->capture;
+/// Compute the new encoder value from a captured value
+static int32_t quadra_new_value(quadra_t *enc, uint32_t capture)
+{
+  // non-extended counters wrap on 16 bits
+  uint32_t diff = capture - enc->capture;
   enc->capture = capture;
+  int32_t value = enc->value + (enc->extended ? (int32_t)diff : (int16_t)diff);
+
+  if(enc->home_state == QUADRA_HOME_LATCHED) {
+    diff = capture - enc->index_capture;
+    int32_t home = enc->home_value + (enc->extended ? (int32_t)diff : (int16_t)diff);
+    enc->edge_value += home - value;
+    value = home;
+    enc->home_state = QUADRA_HOME_DONE;
+  }
+  return value;
+}
+
+
+void quadra_update(quadra_t *enc)
+{
+  // capture a new value, update encoder state
+  int32_t value = quadra_new_value(enc, quadra_capture(enc));
   INTLVL_DISABLE_BLOCK(INTLVL_HI) {
-    enc->value += (int16_t)diff;
+    enc->value = value;
+  }
+
+  // velocity is only updated on the main context, fields are not protected
+  if(enc->vtc) {
+    quadra_update_velocity(enc, value, enc->cap_edge, enc->cap_edge_time, enc->cap_time);
   }
 }
 
 
+int32_t quadra_update_capture(quadra_t *enc, uint32_t capture)
+{
+  int32_t value = quadra_new_value(enc, capture);
+  enc->value = value;
+  if(enc->vtc) {
+    quadra_update_velocity(enc, value, enc->cap_edge, enc->cap_edge_time, enc->cap_time);
+  }
+  return value;
+}
+
+
 int32_t quadra_get_value(quadra_t *enc)
 {
   int32_t ret;
@@ -51,10 +314,54 @@ int32_t quadra_get_value(quadra_t *enc)
 }
 
 
+float quadra_get_velocity(quadra_t *enc)
+{
+  if(!enc->vtc) {
+    return 0;
+  }
+  return (float)enc->vel_count * (CLOCK_PER_FREQ / enc->vdiv) / enc->vel_time;
+}
+
+
 void quadra_set_value(quadra_t *enc, int32_t v)
 {
+  enc->edge_value += v - enc->value;
   enc->value = v;
 }
 
 
+void quadra_init_index(quadra_t *enc, portpin_t ppi, intlvl_t intlvl)
+{
+  portpin_dirclr(&ppi);
+  PORTPIN_CTRL(&ppi) = (PORTPIN_CTRL(&ppi) & ~PORT_ISC_gm) | PORT_ISC_RISING_gc;
+  // clear a stale flag, it would trigger a spurious index
+  ppi.port->INTFLAGS = PORT_INT0IF_bm;
+  portpin_enable_int(&ppi, 0, intlvl);
+}
+
+
+void quadra_home(quadra_t *enc, int32_t v)
+{
+  INTLVL_DISABLE_ALL_BLOCK() {
+    enc->home_value = v;
+    enc->home_state = QUADRA_HOME_ARMED;
+  }
+}
+
+
+bool quadra_is_homed(quadra_t *enc)
+{
+  return enc->home_state == QUADRA_HOME_DONE;
+}
+
+
+void quadra_index(quadra_t *enc)
+{
+  if(enc->home_state == QUADRA_HOME_ARMED) {
+    enc->index_capture = quadra_capture_counter(enc);
+    enc->home_state = QUADRA_HOME_LATCHED;
+  }
+}
+
+
 ///@endcond
@@ -10,7 +10,20 @@
 #define ENCODER_QUADRA_H__
 
 #include <avr/io.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <avarix/portpin.h>
+// configuration is only needed for extended counters
+#if __has_include("quadra_config.h")
+# include "quadra_config.h"
+#endif
+
+
+/** @brief Maximum time between two edges for velocity estimation, in ticks
+ *
+ * If no edge is captured for longer, velocity is considered null.
+ */
+#define QUADRA_VELOCITY_TIMEOUT  0x8000
 
 
 /** Quadrature encoder data
@@ -18,8 +31,23 @@
  */
 typedef struct {
   TC1_t *tc;  ///< timer used to decode the quadrature signal
-  uint16_t capture;  ///< last captured value
+  uint32_t capture;  ///< last captured value
   int32_t value;  ///< current encoder value
+  bool extended;  ///< true if the counter is extended to 32 bits
+  volatile uint16_t high;  ///< high word of the extended counter
+  volatile uint8_t home_state;  ///< homing state
+  int32_t home_value;  ///< encoder value at the index, for homing
+  volatile uint32_t index_capture;  ///< captured value at the index
+  TC1_t *vtc;  ///< timer capturing edges, NULL if velocity is not estimated
+  uint16_t vdiv;  ///< prescaler factor of the velocity timer
+  bool edge_valid;  ///< true if there is a reference edge
+  uint16_t edge_time;  ///< capture time of the reference edge
+  int32_t edge_value;  ///< encoder value at the reference edge
+  int32_t vel_count;  ///< counts of the last velocity measurement
+  uint16_t vel_time;  ///< duration of the last velocity measurement, in ticks
+  bool cap_edge;  ///< true if an edge has been read by the last capture
+  uint16_t cap_edge_time;  ///< time of the edge read by the last capture
+  uint16_t cap_time;  ///< velocity timer value at the last capture
 } quadra_t;
 
 
@@ -37,18 +65,111 @@ typedef struct {
  * timers of type 0 can be used too.
  *
  * Input signal must use pins valid as event source (port A to F).
+ *
+ * If \ref QUADRA_TCxn_EXTENDED is defined for the timer, the overflow
+ * interrupt is enabled to extend the counter to 32 bits.
+ * The direction of a wrap is deduced from the counter value when the overflow
+ * is handled, see the configuration for the resulting limitation.
  */
 void quadra_init(quadra_t *enc, TC1_t *tc, uint8_t evch, portpin_t pp0, portpin_t pp90, uint8_t samples);
 
+/** @brief Enable velocity estimation
+ *
+ * @param enc  quadrature encoder, already initialized
+ * @param tc  timer to use to capture edges (can also be a pointer to a \e TC0_t)
+ * @param evch  event channel to use, not used by the decoder
+ * @param ppe  port pin wired to the reference encoder signal, distinct from
+ *             the decoder pins
+ * @param div  timer prescaler factor (1, 2, 4, 8, 64, 256 or 1024)
+ * @param samples  length of digital filtering (1 to 8)
+ *
+ * Decoder pins are configured with level sensing, required by the quadrature
+ * decoder. Their events are asserted for as long as the pin is low, and can't
+ * be used to capture edges. The reference signal must therefore also be wired
+ * to a second pin, valid as event source (port A to F), which is configured to
+ * sense rising edges.
+ *
+ * Rising edges of the reference signal are timestamped using input capture on
+ * channel A of the timer. Velocity is then computed by \ref quadra_update()
+ * from the counts and the time between the last edge captured by the previous
+ * measurement and the last captured edge. This gives 1/T estimation at low
+ * speed and dN/dt estimation at high speed, without interrupts.
+ *
+ * The timer must not be shared. With prescaler \e div, \ref quadra_update()
+ * must be called at least every \ref QUADRA_VELOCITY_TIMEOUT ticks.
+ */
+void quadra_init_velocity(quadra_t *enc, TC1_t *tc, uint8_t evch, portpin_t ppe, uint16_t div, uint8_t samples);
+
 /// Update encoder value, should be called often
 void quadra_update(quadra_t *enc);
 
+/** @brief Capture the counter value, for \ref quadra_update_capture()
+ *
+ * Capturing values of several encoders then updating them allows to sample
+ * them almost at the same time.
+ *
+ * Edges captured for velocity estimation are read along with the counter.
+ */
+uint32_t quadra_capture(quadra_t *enc);
+
+/** @brief Update encoder value from a captured counter value
+ *
+ * Encoder value is not protected, the caller must disable interrupts of level
+ * \e INTLVL_HI and lower. Return the updated value.
+ */
+int32_t quadra_update_capture(quadra_t *enc, uint32_t capture);
+
 /// Get the current decoder value
 int32_t quadra_get_value(quadra_t *enc);
 
+/** @brief Get the current velocity, in counts per second
+ *
+ * When no edge has been captured since the last measurement, velocity
+ * decreases as if an edge was about to be captured.
+ * Return 0 if velocity estimation is not enabled.
+ */
+float quadra_get_velocity(quadra_t *enc);
+
 /// Reset the decoder value
 void quadra_set_value(quadra_t *enc, int32_t v);
 
 
+/** @name Homing
+ *
+ * The index signal of the encoder is handled by a pin interrupt, which
+ * latches the counter value. The interrupt handler must be defined by the
+ * application, since the pin interrupt may be shared:
+ * @code
+ * ISR(PORTC_INT0_vect) { quadra_index(&enc); }
+ * @endcode
+ */
+//@{
+
+/** @brief Configure the index pin
+ *
+ * @param enc  quadrature encoder
+ * @param ppi  port pin of the index signal
+ * @param intlvl  level of the pin interrupt (INT0 of the port)
+ *
+ * Index is triggered on rising edges.
+ */
+void quadra_init_index(quadra_t *enc, portpin_t ppi, intlvl_t intlvl);
+
+/** @brief Home the encoder on the next index
+ *
+ * Encoder value at the next index is set to \e v.
+ * The new value is applied by the next update.
+ */
+void quadra_home(quadra_t *enc, int32_t v);
+
+/// Return true if the encoder has been homed since the last \ref quadra_home()
+bool quadra_is_homed(quadra_t *enc);
+
+/// Handle an index pulse, must be called by the pin interrupt handler
+void quadra_index(quadra_t *enc);
+
+//@}
+
+
 #endif
 //@}
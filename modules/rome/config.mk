@@ -1,7 +1,7 @@
 SRCS = rome.c
 MODULES = uart timer
 
-GEN_FILES = rome_msg.h
+GEN_FILES = rome_msg.h rome_msg.inc.c
 
 ifeq ($(ROME_MESSAGES),)
 rome_msg_deps = $(shell python3 -c 'import rome_messages as m; print(m.__file__.replace(".pyc",".py"))')
@@ -15,3 +15,9 @@ $(eval $(call py_templatize_rule, \
 	$(src_dir)/rome_msg.py $(rome_msg_deps) \
 	))
 
+
+$(eval $(call py_templatize_rule, \
+	$(src_dir)/rome_msg.tpl.c, rome_msg.inc.c, \
+	$(src_dir)/rome_msg.py $(ROME_MESSAGES), \
+	$(src_dir)/rome_msg.py $(rome_msg_deps) \
+	))
@@ -13,6 +13,12 @@
  */
 #undef ROME_ENABLE_XBEE_API
 
+/** @brief If set, enable aggregation of frames sent using XBee API
+ *
+ * @note Uptime must be configured in the \e timer module.
+ */
+#undef ROME_ENABLE_XBEE_AGGR
+
 /** @brief Disabled interrupt level when sending ROME frames
  *
  * If ROME frames are sent from the main and and an interrupt routine, frames
@@ -20,7 +26,9 @@
  * If this value is set, ROME frames can be safely sent from any interrupt of
  * configured (or lower) level.
  *
- * @note This is not used for data sent using XBee API.
+ * @note This is not used for data sent using XBee API. Aggregators only use it
+ * to protect their buffer: data is sent with interrupts enabled, since
+ * xbee_send() may wait for TX status frames.
  *
  * @sa ROME_SEND_INTLVL_DISABLE()
  */
@@ -34,6 +42,19 @@
 /// ACK waiting time before resending an order, in microseconds
 #define ROME_ACK_TIMEOUT_US  500000
 
+/** @brief Message ID of compact frames
+ *
+ * If set, enable compact encoding of messages.
+ * The value must not be used by any other message.
+ */
+#undef ROME_COMPACT_MID
+
+/** @brief Send a compact keyframe every N frames
+ *
+ * Sequence numbers are 7-bit, the value must divide 128.
+ */
+#define ROME_COMPACT_KEYFRAME_PERIOD  16
+
 /// If defined, disable sending of messages X
 #define ROME_DISABLE_X
 
@@ -2,10 +2,13 @@
  * @cond internal
  * @file
  */
+#include <string.h>
 #include <util/crc16.h>
 #include "rome.h"
-#ifdef ROME_ACK_MIN
+#if (defined ROME_ACK_MIN) || (defined ROME_ENABLE_XBEE_AGGR)
 #include <timer/uptime.h>
+#endif
+#ifdef ROME_ACK_MIN
 #include <idle/idle.h>
 #endif
 
@@ -88,23 +91,46 @@ rome_frame_t *rome_reader_read(rome_reader_t *reader)
 }
 
 
-const rome_frame_t *rome_parse_frame(const uint8_t data[], uint8_t len)
+/// Check the frame at the beginning of a buffer, return its size, 0 if invalid
+static uint8_t rome_check_frame(const uint8_t data[], uint8_t len)
 {
   if(len < 3+0+2) {
-    return NULL;  // not enough bytes for a valid frame
+    return 0;  // not enough bytes for a valid frame
   }
   if(data[0] != ROME_START_BYTE) {
-    return NULL;  // wrong start byte
+    return 0;  // wrong start byte
   }
-  if(len != 3+data[1]+2) {
-    return NULL;  // wrong plsize
+  if(len < 3+data[1]+2) {
+    return 0;  // wrong plsize
   }
 
   const rome_frame_t *const frame = (const rome_frame_t*)data;
   if(rome_compute_crc(frame) != rome_frame_get_crc(frame)) {
-    return NULL;  // CRC mismatch
+    return 0;  // CRC mismatch
+  }
+
+  return 3+data[1]+2;
+}
+
+const rome_frame_t *rome_parse_frame(const uint8_t data[], uint8_t len)
+{
+  const uint8_t size = rome_check_frame(data, len);
+  if(size == 0 || size != len) {
+    return NULL;
   }
+  return (const rome_frame_t*)data;
+}
 
+const rome_frame_t *rome_parse_next_frame(const uint8_t **data, uint8_t *len)
+{
+  const uint8_t size = rome_check_frame(*data, *len);
+  if(size == 0) {
+    *len = 0;  // ignore remaining data
+    return NULL;
+  }
+  const rome_frame_t *const frame = (const rome_frame_t*)*data;
+  *data += size;
+  *len -= size;
   return frame;
 }
 
@@ -138,6 +164,278 @@ void rome_send_xbee(xbee_intf_t *xbee, uint16_t addr, const rome_frame_t *frame)
   xbee_send(xbee, addr, (const uint8_t*)frame, 3 + frame->plsize + 2);
 }
 
+# ifdef ROME_ENABLE_XBEE_AGGR
+
+void rome_xbee_aggr_init(rome_xbee_aggr_t *aggr, xbee_intf_t *xbee, uint32_t delay)
+{
+  aggr->xbee = xbee;
+  aggr->delay = delay;
+  aggr->deadline = 0;
+  aggr->addr = XBEE_BROADCAST;
+  aggr->len = 0;
+}
+
+void rome_send_xbee_aggr(rome_xbee_aggr_t *aggr, uint16_t addr, const rome_frame_t *frame)
+{
+  if(frame->mid == 0) {
+    return;
+  }
+
+  const uint8_t size = 3 + frame->plsize + 2;
+  if(size > sizeof(aggr->buf)) {
+    // too large to be buffered, send it directly, after buffered frames
+    rome_xbee_aggr_flush(aggr);
+    xbee_send(aggr->xbee, addr, (const uint8_t*)frame, size);
+    return;
+  }
+
+  bool full = false;
+  for(;;) {
+    bool added = false;
+    ROME_SEND_INTLVL_DISABLE() {
+      // buffered frames are flushed if they cannot be packed with the new one
+      if(aggr->len == 0 || (aggr->addr == addr && aggr->len + size <= sizeof(aggr->buf))) {
+        if(aggr->len == 0) {
+          aggr->addr = addr;
+          aggr->deadline = uptime_us() + aggr->delay;
+        }
+        memcpy(&aggr->buf[aggr->len], frame, size);
+        aggr->len += size;
+        // flush if there is no room left for another frame
+        full = aggr->len > sizeof(aggr->buf) - (3+0+2);
+        added = true;
+      }
+    }
+    if(added) {
+      break;
+    }
+    rome_xbee_aggr_flush(aggr);
+  }
+  if(full) {
+    rome_xbee_aggr_flush(aggr);
+  }
+}
+
+void rome_xbee_aggr_flush(rome_xbee_aggr_t *aggr)
+{
+  // detach buffered frames before sending them: xbee_send() may process input
+  // and frames sent by handlers are then buffered again instead of being lost
+  uint8_t buf[sizeof(aggr->buf)];
+  uint8_t len;
+  uint16_t addr;
+  ROME_SEND_INTLVL_DISABLE() {
+    len = aggr->len;
+    addr = aggr->addr;
+    memcpy(buf, aggr->buf, len);
+    aggr->len = 0;
+  }
+  if(len) {
+    xbee_send(aggr->xbee, addr, buf, len);
+  }
+}
+
+void rome_xbee_aggr_update(rome_xbee_aggr_t *aggr)
+{
+  const uint32_t now = uptime_us();
+  bool flush;
+  ROME_SEND_INTLVL_DISABLE() {
+    flush = aggr->len && (int32_t)(now - aggr->deadline) >= 0;
+  }
+  if(flush) {
+    rome_xbee_aggr_flush(aggr);
+  }
+}
+
+# endif
+
+#endif
+
+
+#ifdef ROME_COMPACT_MID
+
+/// Compact field flag, field is not delta-encoded
+#define ROME_COMPACT_RAW  0x80
+/// Compact sequence flag, frame is a keyframe
+#define ROME_COMPACT_KEYFRAME  0x80
+/// Compact state flag, reference frame is valid
+#define ROME_COMPACT_VALID  0x80
+
+// keyframes are sent on 7-bit sequence numbers
+#if 128 % (ROME_COMPACT_KEYFRAME_PERIOD) != 0
+# error ROME_COMPACT_KEYFRAME_PERIOD must divide 128
+#endif
+
+/// Description of a message using compact encoding
+typedef struct {
+  uint8_t mid;  ///< message ID
+  uint8_t plsize;  ///< payload size of the decoded message
+  uint8_t nfields;  ///< number of fields
+  uint16_t offset;  ///< offset of message data in rome_compact_state_t
+  /// fields size, with ROME_COMPACT_RAW set for raw fields
+  const uint8_t *fields;
+} rome_compact_desc_t;
+
+#include "rome/rome_msg.inc.c"
+
+
+/// Get compact description of a message, NULL if not found
+static const rome_compact_desc_t *rome_compact_get_desc(uint8_t mid)
+{
+  if(mid == 0) {
+    return NULL;  // disabled message
+  }
+  for(uint8_t i=0; i<ROME_COMPACT_MESSAGES_COUNT; i++) {
+    if(rome_compact_descs[i].mid == mid) {
+      return &rome_compact_descs[i];
+    }
+  }
+  return NULL;
+}
+
+/// Load a little-endian field value
+static uint32_t rome_compact_load(const uint8_t *p, uint8_t size)
+{
+  uint32_t v = 0;
+  for(uint8_t i=size; i>0; i--) {
+    v = (v << 8) | p[i-1];
+  }
+  return v;
+}
+
+/// Store a little-endian field value
+static void rome_compact_store(uint8_t *p, uint8_t size, uint32_t v)
+{
+  for(uint8_t i=0; i<size; i++) {
+    p[i] = v;
+    v >>= 8;
+  }
+}
+
+
+bool rome_compact_encode(rome_compact_state_t *state, const rome_frame_t *frame, rome_frame_t *out)
+{
+  const rome_compact_desc_t *desc = rome_compact_get_desc(frame->mid);
+  if(!desc || frame->plsize != desc->plsize) {
+    return false;
+  }
+
+  // first byte is the sequence (and flags), followed by reference data
+  uint8_t *const seqp = (uint8_t*)state + desc->offset;
+  uint8_t *ref = seqp + 1;
+
+  const uint8_t seq = (*seqp + 1) & 0x7f;
+  const bool keyframe = !(*seqp & ROME_COMPACT_VALID) || seq % (ROME_COMPACT_KEYFRAME_PERIOD) == 0;
+  if(keyframe) {
+    memset(ref, 0, desc->plsize);
+  }
+
+  uint8_t *p = out->_data;
+  *p++ = frame->mid;
+  *p++ = keyframe ? seq | ROME_COMPACT_KEYFRAME : seq;
+  const uint8_t *src = frame->_data;
+  for(uint8_t i=0; i<desc->nfields; i++) {
+    const uint8_t size = desc->fields[i] & ~ROME_COMPACT_RAW;
+    if(desc->fields[i] & ROME_COMPACT_RAW) {
+      memcpy(p, src, size);
+      p += size;
+    } else {
+      // delta, sign-extended from field size, sent as a zigzag varint
+      const uint8_t shift = 32 - 8*size;
+      const int32_t delta = (int32_t)((rome_compact_load(src, size) - rome_compact_load(ref, size)) << shift) >> shift;
+      uint32_t v = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+      while(v >= 0x80) {
+        *p++ = v | 0x80;
+        v >>= 7;
+      }
+      *p++ = v;
+    }
+    src += size;
+    ref += size;
+  }
+
+  // sent frame is the new reference
+  memcpy(seqp + 1, frame->_data, desc->plsize);
+  *seqp = seq | ROME_COMPACT_VALID;
+
+  out->plsize = p - out->_data;
+  out->mid = ROME_COMPACT_MID;
+  rome_finalize_frame(out);
+  return true;
+}
+
+
+const rome_frame_t *rome_compact_decode(rome_compact_state_t *state, const rome_frame_t *frame, rome_frame_t *out)
+{
+  if(frame->mid != (ROME_COMPACT_MID) || frame->plsize < 2) {
+    return NULL;
+  }
+  const rome_compact_desc_t *desc = rome_compact_get_desc(frame->_data[0]);
+  if(!desc) {
+    return NULL;
+  }
+
+  uint8_t *const seqp = (uint8_t*)state + desc->offset;
+  const uint8_t seq = frame->_data[1] & 0x7f;
+  if(frame->_data[1] & ROME_COMPACT_KEYFRAME) {
+    memset(seqp + 1, 0, desc->plsize);
+  } else if(*seqp != (((seq - 1) & 0x7f) | ROME_COMPACT_VALID)) {
+    return NULL;  // reference frame lost, wait for the next keyframe
+  }
+
+  const uint8_t *p = &frame->_data[2];
+  const uint8_t *const end = &frame->_data[frame->plsize];
+  const uint8_t *ref = seqp + 1;
+  uint8_t *dst = out->_data;
+  for(uint8_t i=0; i<desc->nfields; i++) {
+    const uint8_t size = desc->fields[i] & ~ROME_COMPACT_RAW;
+    if(desc->fields[i] & ROME_COMPACT_RAW) {
+      if(end - p < size) {
+        goto invalid;
+      }
+      memcpy(dst, p, size);
+      p += size;
+    } else {
+      uint32_t v = 0;
+      uint8_t shift = 0;
+      uint8_t b;
+      do {
+        if(p == end || shift > 28) {
+          goto invalid;
+        }
+        b = *p++;
+        v |= (uint32_t)(b & 0x7f) << shift;
+        shift += 7;
+      } while(b & 0x80);
+      const uint32_t delta = (v >> 1) ^ -(v & 1);
+      rome_compact_store(dst, size, rome_compact_load(ref, size) + delta);
+    }
+    dst += size;
+    ref += size;
+  }
+  if(p != end) {
+    goto invalid;
+  }
+
+  // decoded frame is the new reference
+  memcpy(seqp + 1, out->_data, desc->plsize);
+  *seqp = seq | ROME_COMPACT_VALID;
+
+  out->plsize = desc->plsize;
+  out->mid = desc->mid;
+  rome_finalize_frame(out);
+  return out;
+
+ invalid:
+  *seqp = 0;
+  return NULL;
+}
+
+
+void rome_compact_reset(rome_compact_state_t *state)
+{
+  memset(state, 0, sizeof(*state));
+}
+
 #endif
 
 
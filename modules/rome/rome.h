@@ -7,6 +7,8 @@
  *  - When using UART, frames are read using a \ref rome_reader_t and \ref
  *    rome_reader_read().
  *  - When using XBee API, frames can be parsed using \ref rome_parse_frame().
+ *    When several frames may be packed in a single XBee frame, they can be
+ *    iterated using \ref rome_parse_next_frame().
  *
  * In both cases, frames can be sent using the appropriated `rome_send_*()`
  * method or one of the `ROME_SEND_*()` helpers.
@@ -27,6 +29,25 @@
  *
  * Currently used ACK values are stored in an array. This allows to keep track
  * of which orders have been acknowledged.
+ *
+ * @par Compact encoding
+ *
+ * Messages listed in the \e compact_messages list of the messages definition
+ * module can be sent using a compact encoding, enabled by defining
+ * \ref ROME_COMPACT_MID.
+ *
+ * Integer fields are encoded as the difference with the last sent frame of
+ * the same message, using zigzag varints. Float fields are sent unchanged.
+ * Compact frames are sent with the \ref ROME_COMPACT_MID message ID and must
+ * be decoded by the recipient with \ref rome_compact_decode().
+ *
+ * A keyframe, encoded against zero, is sent every
+ * \ref ROME_COMPACT_KEYFRAME_PERIOD frames. When a frame is lost, following
+ * frames are dropped by the recipient until the next keyframe.
+ *
+ * Frame header, CRC and float fields are not reduced, and each compact frame
+ * adds a 2-byte header. Gain is therefore limited on short messages; it is
+ * best on messages with several slowly changing integer fields.
  */
 //@{
 /**
@@ -86,6 +107,26 @@ rome_frame_t *rome_reader_read(rome_reader_t *reader);
  */
 const rome_frame_t *rome_parse_frame(const uint8_t data[], uint8_t len);
 
+/** @brief Parse the next frame from a buffer containing several frames
+ *
+ * Return a pointer to the first frame of the buffer, or NULL if there is no
+ * more valid frame. \a data and \a len are updated to point after the parsed
+ * frame.
+ *
+ * Typical use:
+ * @code
+ * const uint8_t *data = frame->rx16.data;
+ * uint8_t len = frame->length - 5;
+ * const rome_frame_t *rframe;
+ * while((rframe = rome_parse_next_frame(&data, &len))) {
+ *   handle_frame(rframe);
+ * }
+ * @endcode
+ *
+ * @note The returned pointer is bounded to \a data.
+ */
+const rome_frame_t *rome_parse_next_frame(const uint8_t **data, uint8_t *len);
+
 /// Set frame's start byte and CRC from its payload
 void rome_finalize_frame(rome_frame_t *frame);
 
@@ -127,6 +168,85 @@ inline void rome_send_xbee_dst(rome_xbee_dst_t dst, const rome_frame_t *frame)
   rome_send_xbee(dst.xbee, dst.addr, frame);
 }
 
+# ifdef ROME_ENABLE_XBEE_AGGR
+
+/** @brief Aggregate frames sent to an XBee interface
+ *
+ * Consecutive frames sent to the same address are packed in a single XBee API
+ * frame. Buffered frames are sent when the buffer is full, when frames are
+ * sent to another address, when the deadline is reached (see
+ * \ref rome_xbee_aggr_update()) or when explicitly flushed.
+ *
+ * Recipients must parse received data using \ref rome_parse_next_frame().
+ *
+ * Buffered frames are detached from the aggregator before being sent. Frames
+ * sent meanwhile (for instance from a frame handler called while xbee_send()
+ * waits for TX status) are buffered for the next flush.
+ *
+ * If \e XBEE_TX_WINDOW is set, sending may wait for room in the TX window.
+ * Frames must then not be sent nor flushed from an interrupt routine or with
+ * interrupts disabled.
+ *
+ * @note Fields are private and should not be accessed directly.
+ */
+typedef struct {
+  xbee_intf_t *xbee;  ///< XBee interface used to send data
+  uint32_t delay;  ///< maximum buffering delay, in microseconds
+  uint32_t deadline;  ///< uptime at which buffered data must be sent
+  uint16_t addr;  ///< address of buffered frames
+  uint8_t len;  ///< size of buffered data
+  uint8_t buf[XBEE_MAX_DATA_SIZE];  ///< buffered data
+} rome_xbee_aggr_t;
+
+/** @brief Initialize an XBee aggregator
+ *
+ * @param aggr  aggregator to initialize
+ * @param xbee  XBee interface used to send frames
+ * @param delay  maximum time a frame is buffered, in microseconds
+ */
+void rome_xbee_aggr_init(rome_xbee_aggr_t *aggr, xbee_intf_t *xbee, uint32_t delay);
+
+/** @brief Send a frame to an XBee address through an aggregator
+ *
+ * The frame must have been finalized (see rome_finalize_frame()).
+ */
+void rome_send_xbee_aggr(rome_xbee_aggr_t *aggr, uint16_t addr, const rome_frame_t *frame);
+
+/// Send buffered frames of an aggregator
+void rome_xbee_aggr_flush(rome_xbee_aggr_t *aggr);
+
+/** @brief Send buffered frames if their deadline has been reached
+ *
+ * This method should be called regularly, for instance from an idle task.
+ */
+void rome_xbee_aggr_update(rome_xbee_aggr_t *aggr);
+
+/** Broadcast a frame through an XBee aggregator
+ *
+ * The frame must have been finalized (see rome_finalize_frame()).
+ */
+inline void rome_send_xbee_aggr_broadcast(rome_xbee_aggr_t *aggr, const rome_frame_t *frame)
+{
+  rome_send_xbee_aggr(aggr, XBEE_BROADCAST, frame);
+}
+
+/// ROME destination for a specific XBee address, through an aggregator
+typedef struct {
+  rome_xbee_aggr_t *aggr;
+  uint16_t addr;
+} rome_xbee_aggr_dst_t;
+
+/// Return a rome_xbee_aggr_dst_t for an aggregator and address
+#define ROME_XBEE_AGGR_DST(aggr,addr)  ((rome_xbee_aggr_dst_t){ (aggr), (addr) })
+
+/// Send a frame to an XBee destination through an aggregator
+inline void rome_send_xbee_aggr_dst(rome_xbee_aggr_dst_t dst, const rome_frame_t *frame)
+{
+  rome_send_xbee_aggr(dst.aggr, dst.addr, frame);
+}
+
+# endif
+
 #endif
 
 #ifdef DOXYGEN
@@ -136,7 +256,16 @@ inline void rome_send_xbee_dst(rome_xbee_dst_t dst, const rome_frame_t *frame)
 
 #else
 
-# ifdef ROME_ENABLE_XBEE_API
+# if (defined ROME_ENABLE_XBEE_API) && (defined ROME_ENABLE_XBEE_AGGR)
+#  define rome_send(dst, frame) \
+    _Generic((dst) \
+             , uart_t*: rome_send_uart \
+             , xbee_intf_t*: rome_send_xbee_broadcast \
+             , rome_xbee_dst_t: rome_send_xbee_dst \
+             , rome_xbee_aggr_t*: rome_send_xbee_aggr_broadcast \
+             , rome_xbee_aggr_dst_t: rome_send_xbee_aggr_dst \
+             )(dst, frame)
+# elif (defined ROME_ENABLE_XBEE_API)
 #  define rome_send(dst, frame) \
     _Generic((dst) \
              , uart_t*: rome_send_uart \
@@ -150,6 +279,34 @@ inline void rome_send_xbee_dst(rome_xbee_dst_t dst, const rome_frame_t *frame)
 #endif
 
 
+#if (defined DOXYGEN) || (defined ROME_COMPACT_MID)
+
+/** @brief Encode a frame using compact encoding
+ *
+ * \a out must be large enough to store the encoded frame, which can be
+ * slightly larger than the original one. The output frame is finalized.
+ *
+ * Return false if the message does not use compact encoding.
+ */
+bool rome_compact_encode(rome_compact_state_t *state, const rome_frame_t *frame, rome_frame_t *out);
+
+/** @brief Decode a compact frame
+ *
+ * Return a pointer to \a out, or NULL if the frame is invalid or if the
+ * reference frame has been lost.
+ */
+const rome_frame_t *rome_compact_decode(rome_compact_state_t *state, const rome_frame_t *frame, rome_frame_t *out);
+
+/** @brief Reset a compact encoding state
+ *
+ * The next encoded frame will be a keyframe.
+ * A zero-initialized state is already reset.
+ */
+void rome_compact_reset(rome_compact_state_t *state);
+
+#endif
+
+
 /// Reply to a frame with a ACK message
 #define rome_reply_ack(intf, frame)  ROME_SEND_ACK((intf), (frame)->_data[0])
 
@@ -8,11 +8,22 @@ class CodeGenerator:
 
   Attributes:
     messages -- list ROME messages, sorted by message ID
+    compact_messages -- list of messages using compact encoding
 
   """
 
-  def __init__(self):
+  def __init__(self, compact=()):
     self.messages = sorted(rome.messages.values(), key=lambda m: m.mid)
+    compact = set(compact)
+    self.compact_messages = [msg for msg in self.messages if msg.name in compact]
+    unknown = compact - set(msg.name for msg in self.compact_messages)
+    if unknown:
+      raise ValueError("unknown compact messages: %s" % ', '.join(sorted(unknown)))
+    for msg in self.compact_messages:
+      if msg.varsize or isinstance(msg, rome.frame.Order):
+        raise TypeError("compact encoding not supported for message %s" % msg.name)
+      if self.compact_max_plsize(msg) > self.max_param_size():
+        raise ValueError("compact encoding of message %s is too large" % msg.name)
 
   @classmethod
   def c_typedecl(cls, typ, name):
@@ -190,6 +201,91 @@ class CodeGenerator:
     return ret
 
 
+  @classmethod
+  def compact_fields(cls, typ):
+    """Return compact fields of a ROME type, as (size, raw) pairs
+
+    Raw fields are copied as is, other fields are delta-encoded.
+    """
+    if issubclass(typ, rome.types.ArrayType):
+      return cls.compact_fields(typ.base) * typ.array_size
+    elif issubclass(typ, rome.types.rome_float):
+      return [(typ.packsize, True)]
+    elif issubclass(typ, (rome.types.rome_int, rome.types.EnumType)):
+      if typ.packsize not in (1, 2, 4):
+        raise TypeError("unsupported type for compact encoding: %s" % typ)
+      return [(typ.packsize, False)]
+    else:
+      raise TypeError("unsupported type for compact encoding: %s" % typ)
+
+  @classmethod
+  def compact_max_plsize(cls, msg):
+    """Return the maximum payload size of a compact frame"""
+    size = 2  # message ID and sequence
+    for _, t in msg.ptypes:
+      for n, raw in cls.compact_fields(t):
+        # a delta is sent as a zigzag varint, 7 bits per byte
+        size += n if raw else (8*n + 6) // 7
+    return size
+
+  def compact_state_struct(self):
+    if not self.compact_messages:
+      return (
+          '#define ROME_COMPACT_MESSAGES_COUNT  0\n'
+          '\n'
+          '#ifdef ROME_COMPACT_MID\n'
+          '# error ROME_COMPACT_MID defined but no message uses compact encoding\n'
+          '#endif\n'
+          )
+    fields = ''.join(
+        '  struct {\n'
+        '    uint8_t seq;\n'
+        '    uint8_t ref[%d];\n'
+        '  } %s;\n' % (msg.plsize, msg.name)
+        for msg in self.compact_messages)
+    return (
+        '#define ROME_COMPACT_MESSAGES_COUNT  %d\n'
+        '\n'
+        'typedef struct {\n'
+        '%s'
+        '} rome_compact_state_t;\n'
+        ) % (len(self.compact_messages), fields)
+
+  def compact_macro_helpers(self):
+    ret = ''
+    for msg in self.compact_messages:
+      pnames = ['_a_%s' % v for v, _ in msg.ptypes]
+      ret += (
+          '#define ROME_SEND_COMPACT_%(NAME)s(_i, _s%(pnames)s) do { \\\n'
+          '  uint8_t _buf_[3+%(plsize)d+2]; \\\n'
+          '  rome_frame_t *_frame_ = (rome_frame_t*)_buf_; \\\n'
+          '  ROME_SET_%(NAME)s(_frame_%(paren_pnames)s); \\\n'
+          '  uint8_t _cbuf_[3+%(cplsize)d+2]; \\\n'
+          '  rome_frame_t *_cframe_ = (rome_frame_t*)_cbuf_; \\\n'
+          '  if(rome_compact_encode((_s), _frame_, _cframe_)) { \\\n'
+          '    rome_send((_i), _cframe_); \\\n'
+          '  } \\\n'
+          '} while(0)\n'
+          '\n'
+          ) % {
+              'NAME': msg.name.upper(),
+              'pnames': ''.join(', '+s for s in pnames),
+              'paren_pnames': ''.join(', (%s)' % s for s in pnames),
+              'plsize': msg.plsize,
+              'cplsize': self.compact_max_plsize(msg),
+              }
+    return ret
+
+  def compact_descs(self):
+    ret = ''
+    for msg in self.compact_messages:
+      codes = [('ROME_COMPACT_RAW|%d' if raw else '%d') % n
+               for _, t in msg.ptypes for n, raw in self.compact_fields(t)]
+      ret += '  { %s, %d, %d, offsetof(rome_compact_state_t, %s), (const uint8_t[]){ %s } },\n' % (
+          self.mid_enum_name(msg), msg.plsize, len(codes), msg.name, ', '.join(codes))
+    return ret
+
+
 if __name__ == 'avarix_templatizer':
   import imp
   import sys
@@ -201,8 +297,16 @@ if __name__ == 'avarix_templatizer':
       mod = imp.load_source(module_name, messages)
     else:
       mod = imp.load_module(module_name, *imp.find_module(messages))
+  else:
+    # default messages, as used for dependencies in config.mk
+    try:
+      import rome_messages as mod
+    except ImportError:
+      mod = None
   if len(rome.messages) == 0:
     raise RuntimeError("no defined messages, define ROME_MESSAGES in Makefile")
-  template_locals = {'self': CodeGenerator()}
+  # messages using compact encoding are listed in the messages module
+  compact = getattr(mod, 'compact_messages', ())
+  template_locals = {'self': CodeGenerator(compact)}
 
 
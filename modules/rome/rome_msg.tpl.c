@@ -0,0 +1,8 @@
+// Generation date: $$avarix:time.strftime('%Y-%m-%d %H:%m:%S')$$
+#include <stddef.h>
+
+#if ROME_COMPACT_MESSAGES_COUNT > 0
+static const rome_compact_desc_t rome_compact_descs[] = {
+#pragma avarix_tpl self.compact_descs()
+};
+#endif
@@ -27,6 +27,11 @@
 # endif
 #endif
 
+// check ROME_COMPACT_MID
+#if (defined ROME_COMPACT_MID) && (ROME_COMPACT_MID < 0 || ROME_COMPACT_MID > 255)
+# error ROME_COMPACT_MID is out of range
+#endif
+
 // include after checks of min/max values, on purpose
 #include <stdio.h>
 #include <string.h>
@@ -66,6 +71,22 @@ typedef struct {
   uint16_t _filler;  ///< reserve bytes for CRC
 } __attribute__((__packed__)) rome_frame_t;
 
+/// Number of messages using compact encoding
+#define ROME_COMPACT_MESSAGES_COUNT  1
+
+/** @brief State of a compact encoding stream
+ *
+ * Keep the last frame of each compact message, used as reference for delta
+ * encoding. One state is needed per stream and per direction.
+ */
+typedef struct {
+  /// Data of dummy message
+  struct {
+    uint8_t seq;  ///< sequence of the reference frame
+    uint8_t ref[3];  ///< reference payload
+  } dummy;
+} rome_compact_state_t;
+
 #else
 
 typedef enum {
@@ -87,6 +108,8 @@ typedef struct {
 
 _Static_assert(sizeof(rome_frame_t) < 255, "frame's size should be strictly less than 255");
 
+#pragma avarix_tpl self.compact_state_struct()
+
 #endif
 
 
@@ -122,6 +145,12 @@ _Static_assert(sizeof(rome_frame_t) < 255, "frame's size should be strictly less
 /// Send a fake order until an ACK is received
 #define ROME_SENDWAIT_FAKE(dst, x)
 
+/** @brief Send a dummy message using compact encoding
+ *
+ * \e state is a pointer to the \ref rome_compact_state_t of the stream.
+ */
+#define ROME_SEND_COMPACT_DUMMY(dst, state, a, b)
+
 /// Return maximum size of a variable-size field
 #define ROME_MAX_FIELD_SIZE(msg, field)
 
@@ -163,6 +192,10 @@ _Static_assert(sizeof(rome_frame_t) < 255, "frame's size should be strictly less
 
 #pragma avarix_tpl self.macro_disablers()
 
+#ifdef ROME_COMPACT_MID
+#pragma avarix_tpl self.compact_macro_helpers()
+#endif
+
 #endif
 
 #endif
@@ -3,6 +3,7 @@
  * @file
  */
 #include <stdbool.h>
+#include <string.h>
 #include <avarix.h>
 #include "uart.h"
 
@@ -21,6 +22,12 @@
 #undef UART_EXPR
 #endif
 
+/** @brief Maximum number of bytes pushed to a TX buffer under a single lock
+ *
+ * It bounds the time spent with interrupts disabled by uart_send_buf().
+ */
+#define UART_SEND_BUF_CHUNK  16
+
 
 /** @brief Circular FIFO buffer for UART data
  *
@@ -85,6 +92,42 @@ static void uart_buf_push(uart_buf_t *b, uint8_t v)
   }
 }
 
+/** @brief Push bytes to the FIFO buffer, as much as possible
+ *
+ * Data is copied in (at most two) contiguous spans.
+ *
+ * @return The number of pushed bytes.
+ */
+static uint8_t uart_buf_push_buf(uart_buf_t *b, const uint8_t buf[], uint8_t len)
+{
+  uint8_t n = 0;
+  while(n < len) {
+    // last free byte before the head, or end of buffer
+    uint8_t *end;
+    if(b->tail < b->head) {
+      end = b->head - 1;
+    } else if(b->head == b->data) {
+      end = uart_buf_end(b) - 1;
+    } else {
+      end = uart_buf_end(b);
+    }
+    uint8_t span = end - b->tail;
+    if(span == 0) {
+      break;  // full
+    }
+    if(span > len - n) {
+      span = len - n;
+    }
+    memcpy(b->tail, buf + n, span);
+    n += span;
+    b->tail += span;
+    if(b->tail == uart_buf_end(b)) {
+      b->tail = b->data;
+    }
+  }
+  return n;
+}
+
 /// Pop a byte from the FIFO buffer
 static uint8_t uart_buf_pop(uart_buf_t *b)
 {
@@ -173,9 +216,36 @@ int uart_send_nowait(uart_t *u, uint8_t v)
 
 void uart_send_buf(uart_t *u, const uint8_t buf[], uint8_t len)
 {
-  for(uint8_t i=0; i<len; ++i) {
-    uart_send(u, buf[i]);
+  while(len) {
+    uint8_t n = uart_send_buf_nowait(u, buf, len);
+    buf += n;
+    len -= n;
+    if(len) {
+      // buffer is full, wait for a free byte
+      uart_send(u, *buf++);
+      len--;
+    }
+  }
+}
+
+uint8_t uart_send_buf_nowait(uart_t *u, const uint8_t buf[], uint8_t len)
+{
+  uint8_t n = 0;
+  while(n < len) {
+    const uint8_t chunk = len - n > UART_SEND_BUF_CHUNK ? UART_SEND_BUF_CHUNK : len - n;
+    uint8_t pushed;
+    INTLVL_DISABLE_ALL_BLOCK() {
+      pushed = uart_buf_push_buf(&u->txbuf, buf + n, chunk);
+      if(pushed) {
+        u->usart->CTRLA |= (UART_INTLVL << USART_DREINTLVL_gp);
+      }
+    }
+    n += pushed;
+    if(pushed < chunk) {
+      break;  // buffer is full
+    }
   }
+  return n;
 }
 
 void uart_send_buf_byte(uart_t *u)
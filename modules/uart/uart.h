@@ -175,9 +175,20 @@ int uart_send(uart_t *u, uint8_t v);
 int uart_send_nowait(uart_t *u, uint8_t v);
 
 /** @brief Send a buffer
+ *
+ * Data is pushed to the buffer in contiguous spans of bounded size, with a
+ * single lock for each span.
  */
 void uart_send_buf(uart_t *u, const uint8_t buf[], uint8_t len);
 
+/** @brief Send a buffer without blocking
+ *
+ * Push as much data as possible to the buffer.
+ *
+ * @return The number of sent bytes.
+ */
+uint8_t uart_send_buf_nowait(uart_t *u, const uint8_t buf[], uint8_t len);
+
 
 /** @brief Open an UART as a standard stream
  *
@@ -1,2 +1,7 @@
 SRCS = xbee.c
 MODULES = uart
+
+# TX status tracking requires uptime
+ifneq ($(shell grep -sE '^\s*\#\s*define\s+XBEE_TX_WINDOW\b' xbee_config.h),)
+MODULES += timer
+endif
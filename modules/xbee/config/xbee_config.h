@@ -19,6 +19,33 @@
  */
 #define XBEE_SEND_INTLVL  INTLVL_LO
 
+/** @brief Maximum number of frames sent without TX status
+ *
+ * If set, TX status of sent frames is tracked.
+ *
+ * @note The \e timer module is then required, with uptime configured.
+ */
+#undef XBEE_TX_WINDOW
+
+/// Time after which a sent frame without TX status is dropped, in microseconds
+#define XBEE_TX_STATUS_TIMEOUT_US  200000
+
+/// Number of destinations for which TX statistics are kept
+#define XBEE_TX_STATS_SIZE  4
+
+/** @brief Use escaped API mode (AP=2)
+ *
+ * Special bytes (0x7E, 0x7D, 0x11, 0x13) are escaped in frames. Radios must
+ * be configured accordingly.
+ */
+#undef XBEE_API_ESCAPED
+
+/** @brief Size of the 16-bit to 64-bit address cache
+ *
+ * If not set, only xbee_send64() can be used to send TX64 frames.
+ */
+#undef XBEE_ADDR_CACHE_SIZE
+
 
 //@}
 //@}
@@ -3,11 +3,24 @@
  * @file
  */
 #include "xbee.h"
+#ifdef XBEE_TX_WINDOW
+#include <timer/uptime.h>
+#endif
 
 
 /// Frame start byte
 #define XBEE_START_BYTE  0x7E
 
+#ifdef XBEE_API_ESCAPED
+/// Escape byte
+#define XBEE_ESCAPE_BYTE  0x7D
+/// Value XORed to escaped bytes
+#define XBEE_ESCAPE_XOR  0x20
+/// Software flow control bytes, escaped
+#define XBEE_XON  0x11
+#define XBEE_XOFF  0x13
+#endif
+
 
 #ifdef XBEE_SEND_INTLVL
 # define XBEE_SEND_INTLVL_DISABLE()  INTLVL_DISABLE_BLOCK(XBEE_SEND_INTLVL)
@@ -21,118 +34,488 @@ void xbee_intf_init(xbee_intf_t *intf, uart_t *uart)
   intf->rstate.pos = 0;
   intf->rstate.checksum = 0xff;
   intf->uart = uart;
+#ifdef XBEE_API_ESCAPED
+  intf->rstate.escape = false;
+#endif
+#ifdef XBEE_ADDR_CACHE_SIZE
+  xbee_addr_cache_clear(intf);
+#endif
+#ifdef XBEE_TX_WINDOW
+  intf->rstate.busy = false;
+  intf->tstate.frame_id = 0;
+  for(uint8_t i=0; i<XBEE_TX_WINDOW; i++) {
+    intf->tstate.pending[i].frame_id = 0;
+  }
+  xbee_reset_tx_stats(intf);
+#endif
 }
 
 
-void xbee_handle_input(xbee_intf_t *intf)
+#ifdef XBEE_TX_WINDOW
+
+/// Get TX statistics of a destination, allocate them if requested
+static xbee_tx_stats_t *xbee_tx_stats(xbee_intf_t *intf, uint16_t addr, bool alloc)
 {
-  uint8_t *const pos = &intf->rstate.pos;
-  uint8_t *const checksum = &intf->rstate.checksum;
+  xbee_tx_stats_t *unused = NULL;
+  for(uint8_t i=0; i<XBEE_TX_STATS_SIZE; i++) {
+    xbee_tx_stats_t *stats = &intf->tstate.stats[i];
+    if(!stats->used) {
+      if(!unused) {
+        unused = stats;
+      }
+    } else if(stats->addr == addr) {
+      return stats;
+    }
+  }
+  if(alloc && unused) {
+    *unused = (xbee_tx_stats_t){ .used = true, .addr = addr };
+    return unused;
+  }
+  return NULL;
+}
 
-  for(;;) {
-    // start byte
-    while(*pos < 1) {
-      switch(uart_recv_nowait(intf->uart)) {
-        case -1:
-          return;
-        case XBEE_START_BYTE:
-          (*pos)++;
-          break;
-        default:
-          *pos = 0;
+/** @brief Release pending frames whose TX status has timed out
+ * @note Must be called with XBEE_SEND_INTLVL disabled.
+ */
+static void xbee_tx_expire(xbee_intf_t *intf, uint32_t now)
+{
+  for(uint8_t i=0; i<XBEE_TX_WINDOW; i++) {
+    xbee_tx_pending_t *pending = &intf->tstate.pending[i];
+    if(pending->frame_id && now - pending->time >= XBEE_TX_STATUS_TIMEOUT_US) {
+      xbee_tx_stats_t *stats = xbee_tx_stats(intf, pending->addr, false);
+      if(stats) {
+        stats->timeout++;
       }
+      pending->frame_id = 0;
     }
+  }
+}
 
-    // length (big endian)
-    if(*pos < 2) {
-      int ret = uart_recv_nowait(intf->uart);
-      if(ret == -1) {
-        return;
+/** @brief Allocate a frame ID for a frame to be sent
+ *
+ * Return the frame ID, 0 if the window is full.
+ */
+static uint8_t xbee_tx_acquire(xbee_intf_t *intf, uint16_t addr)
+{
+  const uint32_t now = uptime_us();
+  uint8_t frame_id = 0;
+  XBEE_SEND_INTLVL_DISABLE() {
+    xbee_tx_expire(intf, now);
+    xbee_tx_pending_t *slot = NULL;
+    for(uint8_t i=0; i<XBEE_TX_WINDOW; i++) {
+      if(intf->tstate.pending[i].frame_id == 0) {
+        slot = &intf->tstate.pending[i];
+        break;
       }
-      intf->rstate.buf[*pos-1+1] = ret; // MSB
-      (*pos)++;
     }
-    if(*pos < 3) {
-      int ret = uart_recv_nowait(intf->uart);
-      if(ret == -1) {
-        return;
+    if(slot) {
+      // next non-zero frame ID not used by a pending frame
+      frame_id = intf->tstate.frame_id;
+      for(;;) {
+        if(++frame_id == 0) {
+          frame_id = 1;
+        }
+        uint8_t i;
+        for(i=0; i<XBEE_TX_WINDOW; i++) {
+          if(intf->tstate.pending[i].frame_id == frame_id) {
+            break;
+          }
+        }
+        if(i == XBEE_TX_WINDOW) {
+          break;
+        }
+      }
+      intf->tstate.frame_id = frame_id;
+      slot->frame_id = frame_id;
+      slot->addr = addr;
+      slot->time = now;
+      xbee_tx_stats_t *stats = xbee_tx_stats(intf, addr, true);
+      if(stats) {
+        stats->sent++;
       }
-      intf->rstate.buf[*pos-1-1] = ret; // LSB
-      (*pos)++;
     }
+  }
+  return frame_id;
+}
 
-    // skip unhandled frames right now (too long)
-    if(intf->rstate.frame.length > sizeof(xbee_frame_t)-2) {
-      while(*pos < 3+intf->rstate.frame.length+1) {
-        int ret = uart_recv_nowait(intf->uart);
-        if(ret == -1) {
-          return;
-        }
-        (*pos)++;
+/// Process a TX status frame
+static void xbee_tx_handle_status(xbee_intf_t *intf, const xbee_frame_t *frame)
+{
+  const uint32_t now = uptime_us();
+  XBEE_SEND_INTLVL_DISABLE() {
+    for(uint8_t i=0; i<XBEE_TX_WINDOW; i++) {
+      xbee_tx_pending_t *pending = &intf->tstate.pending[i];
+      if(pending->frame_id != frame->tx_status.frame_id) {
+        continue;
       }
-    } else {
-      // frame data
-      const uint8_t length = intf->rstate.frame.length;  // truncate to 8-bit
-      while(*pos < 3+length) {
-        int ret = uart_recv_nowait(intf->uart);
-        if(ret == -1) {
-          return;
+      pending->frame_id = 0;
+      xbee_tx_stats_t *stats = xbee_tx_stats(intf, pending->addr, false);
+      if(stats) {
+        switch(frame->tx_status.status) {
+          case XBEE_TX_STATUS_SUCCESS:
+            stats->success++;
+            break;
+          case XBEE_TX_STATUS_NO_ACK:
+            stats->no_ack++;
+            break;
+          case XBEE_TX_STATUS_CCA_FAILURE:
+            stats->cca_failure++;
+            break;
+          default:
+            stats->purged++;
+            break;
+        }
+        const uint32_t latency = now - pending->time;
+        stats->latency_sum += latency;
+        if(latency > stats->latency_max) {
+          stats->latency_max = latency;
         }
-        intf->rstate.buf[*pos-1] = ret;
-        *checksum -= ret;
-        (*pos)++;
       }
+      break;
+    }
+  }
+}
 
-      // checksum
-      if(*pos != 3+length+1) {
-        int ret = uart_recv_nowait(intf->uart);
-        if(ret == -1) {
-          return;
-        }
-        *checksum -= ret;  // compare checksum
-        (*pos)++;
+uint8_t xbee_tx_available(xbee_intf_t *intf)
+{
+  const uint32_t now = uptime_us();
+  uint8_t n = 0;
+  XBEE_SEND_INTLVL_DISABLE() {
+    xbee_tx_expire(intf, now);
+    for(uint8_t i=0; i<XBEE_TX_WINDOW; i++) {
+      if(intf->tstate.pending[i].frame_id == 0) {
+        n++;
       }
+    }
+  }
+  return n;
+}
+
+const xbee_tx_stats_t *xbee_get_tx_stats(xbee_intf_t *intf, uint16_t addr)
+{
+  return xbee_tx_stats(intf, addr, false);
+}
+
+void xbee_reset_tx_stats(xbee_intf_t *intf)
+{
+  XBEE_SEND_INTLVL_DISABLE() {
+    for(uint8_t i=0; i<XBEE_TX_STATS_SIZE; i++) {
+      intf->tstate.stats[i] = (xbee_tx_stats_t){ .used = false };
+    }
+  }
+}
+
+#endif
+
+
+/// Process input data, see xbee_handle_input()
+static void xbee_process_input(xbee_intf_t *intf)
+{
+  xbee_rstate_t *const rstate = &intf->rstate;
+
+  for(;;) {
+    int ret = uart_recv_nowait(intf->uart);
+    if(ret == -1) {
+      return;
+    }
+#ifdef XBEE_API_ESCAPED
+    if(ret == XBEE_START_BYTE) {
+      // unescaped start byte always starts a new frame
+      rstate->pos = 0;
+      rstate->checksum = 0xff;
+      rstate->escape = false;
+    } else if(ret == XBEE_ESCAPE_BYTE) {
+      rstate->escape = true;
+      continue;
+    } else if(rstate->escape) {
+      rstate->escape = false;
+      ret ^= XBEE_ESCAPE_XOR;
+    }
+#endif
 
-      // if CRC matches, handle the frame
-      if(*checksum == 0) {
-        intf->handler(intf, &intf->rstate.frame);
+    const uint8_t pos = rstate->pos;
+    if(pos == 0) {
+      // start byte
+      if(ret == XBEE_START_BYTE) {
+        rstate->pos = 1;
+      }
+      continue;
+    }
+    rstate->pos++;
+
+    // length (big endian)
+    if(pos == 1) {
+      rstate->buf[1] = ret; // MSB
+      continue;
+    }
+    if(pos == 2) {
+      rstate->buf[0] = ret; // LSB
+      continue;
+    }
+
+    if(rstate->frame.length > sizeof(xbee_frame_t)-2) {
+      // skip unhandled frames right now (too long)
+      if(pos < 3+rstate->frame.length) {
+        continue;
+      }
+    } else {
+      const uint8_t length = rstate->frame.length;  // truncate to 8-bit
+      if(pos < 3+length) {
+        // frame data, received in place
+        rstate->buf[pos-1] = ret;
+        rstate->checksum -= ret;
+        continue;
+      }
+
+      // checksum; if it matches, handle the frame
+      rstate->checksum -= ret;
+      if(rstate->checksum == 0) {
+#ifdef XBEE_TX_WINDOW
+        if(rstate->frame.api_id == XBEE_ID_TX_STATUS) {
+          // api_id, frame_id, status
+          if(length >= 3) {
+            xbee_tx_handle_status(intf, &rstate->frame);
+          }
+        } else
+#endif
+        {
+          intf->handler(intf, &rstate->frame);
+        }
       }
     }
 
     // reset state for the next frame
-    *pos = 0;
-    *checksum = 0xff;
+    rstate->pos = 0;
+    rstate->checksum = 0xff;
   }
 }
 
 
-void xbee_send(xbee_intf_t *intf, uint16_t addr, const uint8_t data[], uint8_t len)
+void xbee_handle_input(xbee_intf_t *intf)
 {
+#ifdef XBEE_TX_WINDOW
+  // don't process input from nested calls
+  if(intf->rstate.busy) {
+    return;
+  }
+  intf->rstate.busy = true;
+  xbee_process_input(intf);
+  intf->rstate.busy = false;
+#else
+  xbee_process_input(intf);
+#endif
+}
+
+
+/** @brief Send a span of frame data, escape it if needed
+ *
+ * Unescaped runs are pushed to the UART in a single call.
+ */
+static void xbee_send_span(xbee_intf_t *intf, const uint8_t data[], uint8_t len)
+{
+#ifdef XBEE_API_ESCAPED
+  const uint8_t *run = data;
+  for(uint8_t i=0; i<len; ++i) {
+    const uint8_t v = data[i];
+    if(v == XBEE_START_BYTE || v == XBEE_ESCAPE_BYTE || v == XBEE_XON || v == XBEE_XOFF) {
+      uart_send_buf(intf->uart, run, data + i - run);
+      const uint8_t escaped[2] = { XBEE_ESCAPE_BYTE, v ^ XBEE_ESCAPE_XOR };
+      uart_send_buf(intf->uart, escaped, sizeof(escaped));
+      run = data + i + 1;
+    }
+  }
+  uart_send_buf(intf->uart, run, data + len - run);
+#else
+  uart_send_buf(intf->uart, data, len);
+#endif
+}
+
+
+/** @brief Send data in TX16 or TX64 frames
+ *
+ * Frame header and checksum are computed before sending. Header, payload and
+ * checksum are then pushed to the UART as contiguous spans.
+ *
+ * @param addr  destination 16-bit address, used for TX status tracking
+ * @param addr64  destination 64-bit address, NULL to send TX16 frames
+ * @param wait  if true, wait for room in the TX window
+ *
+ * @return false if a frame could not be sent.
+ */
+static bool xbee_send_frames(xbee_intf_t *intf, uint16_t addr, const xbee_addr64_t *addr64,
+                             const uint8_t data[], uint8_t len, bool wait)
+{
+  const bool broadcast = addr64 ? *addr64 == XBEE_BROADCAST64 : addr == XBEE_BROADCAST;
   while(len) {
-    uint8_t data_len = len > 100 ? 100 : len;
+    uint8_t data_len = len > XBEE_MAX_DATA_SIZE ? XBEE_MAX_DATA_SIZE : len;
+#ifdef XBEE_TX_WINDOW
+    uint8_t frame_id;
+    while((frame_id = xbee_tx_acquire(intf, addr)) == 0) {
+      // window is full, wait for TX status frames
+      // if input is already being processed (nested call from the handler or
+      // from an interrupt), no status can be received: don't wait
+      if(!wait || intf->rstate.busy) {
+        XBEE_SEND_INTLVL_DISABLE() {
+          xbee_tx_stats_t *stats = xbee_tx_stats(intf, addr, false);
+          if(stats) {
+            stats->dropped++;
+          }
+        }
+        return false;
+      }
+      xbee_handle_input(intf);
+    }
+#else
+    (void)wait;
+    const uint8_t frame_id = 0;  // no response frame
+#endif
+
+    // start byte, length, and API header (up to 11 bytes for TX64)
+    uint8_t header[3+11];
+    uint8_t *p = header + 3;
+    if(addr64) {
+      *p++ = XBEE_ID_TX64;
+      *p++ = frame_id;
+      // xbee_addr64_t is stored little endian
+      const uint8_t *paddr = (const uint8_t *)addr64 + sizeof(*addr64);
+      for(uint8_t i=0; i<sizeof(*addr64); ++i) {
+        *p++ = *--paddr;
+      }
+    } else {
+      *p++ = XBEE_ID_TX16;
+      *p++ = frame_id;
+      *p++ = addr >> 8;
+      *p++ = addr;
+    }
+    *p++ = broadcast ? 0x04 : 0;
+    const uint8_t header_len = p - header;
+    header[0] = XBEE_START_BYTE;
+    header[1] = 0;
+    header[2] = header_len - 3 + data_len;  // data_len + 11 <= 111
+
     uint8_t checksum = 0xff;
+    for(uint8_t i=3; i<header_len; ++i) {
+      checksum -= header[i];
+    }
+    for(uint8_t i=0; i<data_len; ++i) {
+      checksum -= data[i];
+    }
+
     XBEE_SEND_INTLVL_DISABLE() {
+#ifdef XBEE_API_ESCAPED
+      // start byte is never escaped
       uart_send(intf->uart, XBEE_START_BYTE);
-      uart_send(intf->uart, 0);
-      uart_send(intf->uart, data_len + 5);  // date_len + 5 <= 105
-#define SEND_BYTE_FOR_CHECKSUM(v) do { \
-        const uint8_t v_ = (v); \
-        uart_send(intf->uart, v); checksum -= v_; \
-      } while(0)
-      SEND_BYTE_FOR_CHECKSUM(0x01);  // API identifier
-      SEND_BYTE_FOR_CHECKSUM(0);  // no response frame
-      SEND_BYTE_FOR_CHECKSUM(addr >> 8);
-      SEND_BYTE_FOR_CHECKSUM(addr);
-      SEND_BYTE_FOR_CHECKSUM(addr == XBEE_BROADCAST ? 0x04 : 0);
-      for(uint8_t i=0; i<data_len; ++i) {
-        SEND_BYTE_FOR_CHECKSUM(data[i]);
-      }
-#undef SEND_BYTE
-      uart_send(intf->uart, checksum);
+      xbee_send_span(intf, header + 1, header_len - 1);
+#else
+      uart_send_buf(intf->uart, header, header_len);
+#endif
+      xbee_send_span(intf, data, data_len);
+      xbee_send_span(intf, &checksum, 1);
     }
     len -= data_len;
     data += data_len;
   }
+  return true;
+}
+
+
+/// Send data to a 16-bit address, using the address cache
+static bool xbee_send_addr(xbee_intf_t *intf, uint16_t addr, const uint8_t data[], uint8_t len, bool wait)
+{
+#ifdef XBEE_ADDR_CACHE_SIZE
+  if(addr != XBEE_BROADCAST) {
+    for(uint8_t i=0; i<XBEE_ADDR_CACHE_SIZE; i++) {
+      if(intf->addr_cache[i].addr == addr) {
+        const xbee_addr64_t addr64 = intf->addr_cache[i].addr64;
+        return xbee_send_frames(intf, addr, &addr64, data, len, wait);
+      }
+    }
+  }
+#endif
+  return xbee_send_frames(intf, addr, NULL, data, len, wait);
+}
+
+bool xbee_send(xbee_intf_t *intf, uint16_t addr, const uint8_t data[], uint8_t len)
+{
+  return xbee_send_addr(intf, addr, data, len, true);
+}
+
+bool xbee_send_nowait(xbee_intf_t *intf, uint16_t addr, const uint8_t data[], uint8_t len)
+{
+  return xbee_send_addr(intf, addr, data, len, false);
+}
+
+
+bool xbee_send64(xbee_intf_t *intf, xbee_addr64_t addr64, const uint8_t data[], uint8_t len)
+{
+  return xbee_send_frames(intf, XBEE_ADDR_USE64, &addr64, data, len, true);
+}
+
+
+uint16_t xbee_frame_src_addr(xbee_intf_t *intf, const xbee_frame_t *frame)
+{
+  if(frame->api_id == XBEE_ID_RX16) {
+    return (frame->rx16.addr_be >> 8) | (frame->rx16.addr_be << 8);
+  }
+#ifdef XBEE_ADDR_CACHE_SIZE
+  if(frame->api_id == XBEE_ID_RX64) {
+    // compare big endian bytes, without converting the address
+    const uint8_t *src = (const uint8_t *)&frame->rx64.addr_be;
+    for(uint8_t i=0; i<XBEE_ADDR_CACHE_SIZE; i++) {
+      const xbee_addr_cache_entry_t *entry = &intf->addr_cache[i];
+      if(entry->addr == XBEE_ADDR_USE64) {
+        continue;
+      }
+      const uint8_t *p = (const uint8_t *)&entry->addr64 + sizeof(entry->addr64);
+      uint8_t j;
+      for(j=0; j<sizeof(entry->addr64); j++) {
+        if(src[j] != *--p) {
+          break;
+        }
+      }
+      if(j == sizeof(entry->addr64)) {
+        return entry->addr;
+      }
+    }
+  }
+#endif
+  return XBEE_ADDR_USE64;
 }
 
+
+#ifdef XBEE_ADDR_CACHE_SIZE
+
+bool xbee_addr_cache_set(xbee_intf_t *intf, uint16_t addr, xbee_addr64_t addr64)
+{
+  xbee_addr_cache_entry_t *unused = NULL;
+  for(uint8_t i=0; i<XBEE_ADDR_CACHE_SIZE; i++) {
+    xbee_addr_cache_entry_t *entry = &intf->addr_cache[i];
+    if(entry->addr == addr) {
+      unused = entry;
+      break;
+    } else if(!unused && entry->addr == XBEE_ADDR_USE64) {
+      unused = entry;
+    }
+  }
+  if(!unused) {
+    return false;
+  }
+  XBEE_SEND_INTLVL_DISABLE() {
+    unused->addr64 = addr64;
+    unused->addr = addr;
+  }
+  return true;
+}
+
+void xbee_addr_cache_clear(xbee_intf_t *intf)
+{
+  XBEE_SEND_INTLVL_DISABLE() {
+    for(uint8_t i=0; i<XBEE_ADDR_CACHE_SIZE; i++) {
+      intf->addr_cache[i].addr = XBEE_ADDR_USE64;
+    }
+  }
+}
+
+#endif
+
 ///@endcond
@@ -12,6 +12,7 @@
 #define AVARIX_XBEE_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <avarix/internal.h>
 #include <uart/uart.h>
 #include "xbee_config.h"
@@ -29,13 +30,41 @@ typedef struct xbee_intf_struct xbee_intf_t;
 /// XBee API broadcast address
 #define XBEE_BROADCAST  0xffff
 
+/// XBee 64-bit broadcast address
+#define XBEE_BROADCAST64  0xffffULL
+
+/** @brief 16-bit address of radios using 64-bit addressing
+ *
+ * Used as source address of received RX64 frames whose source is not in the
+ * address cache, and to account frames sent with xbee_send64().
+ */
+#define XBEE_ADDR_USE64  0xfffe
+
+/// XBee 64-bit address
+typedef uint64_t xbee_addr64_t;
+
+/// Maximum size of data sent or received in a single API frame
+#define XBEE_MAX_DATA_SIZE  100
+
 typedef enum {
+  XBEE_ID_TX64 = 0x00,
   XBEE_ID_TX16 = 0x01,
+  XBEE_ID_RX64 = 0x80,
   XBEE_ID_RX16 = 0x81,
+  XBEE_ID_TX_STATUS = 0x89,
 
 } xbee_api_id_t;
 
-/// XBee API frame (suitable for RX16 only)
+/// Status of a TX status frame
+typedef enum {
+  XBEE_TX_STATUS_SUCCESS = 0,
+  XBEE_TX_STATUS_NO_ACK = 1,
+  XBEE_TX_STATUS_CCA_FAILURE = 2,
+  XBEE_TX_STATUS_PURGED = 3,
+
+} xbee_tx_status_t;
+
+/// XBee API frame (suitable for RX16, RX64 and TX status only)
 typedef struct {
   uint16_t length;  ///< length for API frame
   uint8_t api_id;  ///< API identifier
@@ -44,8 +73,18 @@ typedef struct {
       uint16_t addr_be; // big endian
       uint8_t rssi;
       uint8_t options;
-      uint8_t data[100];
+      uint8_t data[XBEE_MAX_DATA_SIZE];
     } rx16;
+    struct {
+      xbee_addr64_t addr_be; // big endian
+      uint8_t rssi;
+      uint8_t options;
+      uint8_t data[XBEE_MAX_DATA_SIZE];
+    } rx64;
+    struct {
+      uint8_t frame_id;
+      uint8_t status;
+    } tx_status;
   };
 } __attribute__((__packed__)) xbee_frame_t;
 
@@ -61,14 +100,70 @@ typedef struct {
   };
   uint8_t pos;  ///< number of received bytes for the current frame
   uint8_t checksum;  ///< computed checksum
+#ifdef XBEE_TX_WINDOW
+  bool busy;  ///< true while input is being processed
+#endif
+#ifdef XBEE_API_ESCAPED
+  bool escape;  ///< true if next byte is escaped
+#endif
 
 } xbee_rstate_t;
 
+#if (defined DOXYGEN) || (defined XBEE_TX_WINDOW)
+
+/// Frame waiting for its TX status
+typedef struct {
+  uint8_t frame_id;  ///< frame ID, 0 if unused
+  uint16_t addr;  ///< destination address
+  uint32_t time;  ///< uptime at which the frame has been sent
+} xbee_tx_pending_t;
+
+/// TX statistics of a destination
+typedef struct {
+  bool used;  ///< true if the entry is used
+  uint16_t addr;  ///< destination address
+  uint16_t sent;  ///< number of sent frames
+  uint16_t success;  ///< number of frames successfully sent
+  uint16_t no_ack;  ///< number of frames not acknowledged
+  uint16_t cca_failure;  ///< number of frames not sent due to CCA failure
+  uint16_t purged;  ///< number of frames purged by the radio
+  uint16_t timeout;  ///< number of frames whose TX status was not received
+  uint16_t dropped;  ///< number of frames not sent because the window was full
+  uint32_t latency_sum;  ///< sum of TX status latencies, in microseconds
+  uint32_t latency_max;  ///< maximum TX status latency, in microseconds
+} xbee_tx_stats_t;
+
+/// State of sent frames tracking
+typedef struct {
+  uint8_t frame_id;  ///< last used frame ID
+  xbee_tx_pending_t pending[XBEE_TX_WINDOW];  ///< frames waiting for a status
+  xbee_tx_stats_t stats[XBEE_TX_STATS_SIZE];  ///< statistics per destination
+} xbee_tstate_t;
+
+#endif
+
+#if (defined DOXYGEN) || (defined XBEE_ADDR_CACHE_SIZE)
+
+/// Address cache entry
+typedef struct {
+  uint16_t addr;  ///< 16-bit address, XBEE_ADDR_USE64 if unused
+  xbee_addr64_t addr64;  ///< 64-bit address
+} xbee_addr_cache_entry_t;
+
+#endif
+
 /// XBee API interface
 struct xbee_intf_struct {
   uart_t *uart;  ///< UART used by the interface
   xbee_handler_t *handler;  ///< frame handler
   xbee_rstate_t rstate;  ///< state of frame being received (internal)
+#ifdef XBEE_TX_WINDOW
+  xbee_tstate_t tstate;  ///< state of sent frames tracking (internal)
+#endif
+#ifdef XBEE_ADDR_CACHE_SIZE
+  /// 64-bit addresses of radios addressed with a 16-bit address (internal)
+  xbee_addr_cache_entry_t addr_cache[XBEE_ADDR_CACHE_SIZE];
+#endif
 };
 
 
@@ -82,14 +177,103 @@ void xbee_intf_init(xbee_intf_t *intf, uart_t *uart);
 /** @brief Process input data on an interface
  *
  * The frame handler is called for each received frame.
+ *
+ * If \ref XBEE_TX_WINDOW is set, TX status frames are processed internally
+ * and not passed to the handler.
  */
 void xbee_handle_input(xbee_intf_t *intf);
 
 /** Send a data an interface
  *
  * Data is split into multiple API frames if needed. 
+ *
+ * If \ref XBEE_ADDR_CACHE_SIZE is set and the address is in the address
+ * cache, TX64 frames are sent to the cached 64-bit address.
+ *
+ * If \ref XBEE_TX_WINDOW is set and the window is full, input is processed
+ * until a TX status is received or a sent frame times out. Since the frame
+ * handler may be called, input must not be processed concurrently from
+ * another interrupt level. If input is already being processed (call from the
+ * frame handler, or from an interrupt while xbee_handle_input() is running),
+ * the call does not wait and fails.
+ *
+ * @note If \ref XBEE_TX_WINDOW is set, waiting may last up to
+ * \ref XBEE_TX_STATUS_TIMEOUT_US. This function must not be called with
+ * interrupts disabled (for instance with \e ROME_SEND_INTLVL disabled), since
+ * UART input and uptime would not progress. Use xbee_send_nowait() instead.
+ *
+ * @return false if data could not be sent, or only partially.
  */
-void xbee_send(xbee_intf_t *intf, uint16_t addr, const uint8_t data[], uint8_t len);
+bool xbee_send(xbee_intf_t *intf, uint16_t addr, const uint8_t data[], uint8_t len);
+
+/** @brief Send data to an interface, without waiting for the TX window
+ *
+ * Same as xbee_send(), but fail if the TX window is full. It can be called
+ * with interrupts disabled.
+ */
+bool xbee_send_nowait(xbee_intf_t *intf, uint16_t addr, const uint8_t data[], uint8_t len);
+
+/// Send data to a 64-bit address, see xbee_send()
+bool xbee_send64(xbee_intf_t *intf, xbee_addr64_t addr64, const uint8_t data[], uint8_t len);
+
+/** @brief Get the 16-bit source address of a received RX16 or RX64 frame
+ *
+ * For RX64 frames, the address cache is used to retrieve the 16-bit address.
+ * \ref XBEE_ADDR_USE64 is returned if the source is not in the cache.
+ */
+uint16_t xbee_frame_src_addr(xbee_intf_t *intf, const xbee_frame_t *frame);
+
+#if (defined DOXYGEN) || (defined XBEE_ADDR_CACHE_SIZE)
+
+/** @name Address cache
+ *
+ * The address cache associates 16-bit addresses to 64-bit addresses of
+ * radios using 64-bit addressing. This allows modules (such as ROME) to
+ * address such radios using xbee_send().
+ */
+//@{
+
+/** @brief Associate a 16-bit address to a 64-bit address
+ *
+ * Return false if the cache is full.
+ */
+bool xbee_addr_cache_set(xbee_intf_t *intf, uint16_t addr, xbee_addr64_t addr64);
+
+/// Clear the address cache
+void xbee_addr_cache_clear(xbee_intf_t *intf);
+
+//@}
+
+#endif
+
+#if (defined DOXYGEN) || (defined XBEE_TX_WINDOW)
+
+/** @name TX status tracking
+ *
+ * When \ref XBEE_TX_WINDOW is set, sent frames are assigned a frame ID and
+ * the radio replies with a TX status frame. No more than \ref XBEE_TX_WINDOW
+ * frames are sent without having received their status.
+ */
+//@{
+
+/** @brief Return the number of API frames which can be sent without waiting
+ *
+ * It can be used to throttle sending, for instance to skip telemetry.
+ */
+uint8_t xbee_tx_available(xbee_intf_t *intf);
+
+/** @brief Get TX statistics of a destination
+ *
+ * Return NULL if no statistics are available for the destination.
+ */
+const xbee_tx_stats_t *xbee_get_tx_stats(xbee_intf_t *intf, uint16_t addr);
+
+/// Reset TX statistics of all destinations
+void xbee_reset_tx_stats(xbee_intf_t *intf);
+
+//@}
+
+#endif
 
 #endif
 //@}
@@ -0,0 +1,82 @@
+/** @addtogroup adxrs */
+//@{
+/** @file
+ * @brief ADXRS gyro global configuration
+ */
+/** @name Global configuration
+ */
+//@{
+
+/** @brief Use SPIx for ADXRS gyro
+ * @note Only one SPI can be enabled.
+ */
+#define ADXRS_SPIx_ENABLE
+
+/// SPI prescaler factor (2, 4, 8, 16, 32, 64 or 128)
+#define ADXRS_SPI_PRESCALER  16
+
+/// Interrupt level for SPI capture (an \ref intlvl_t value)
+#define ADXRS_CAPTURE_INTLVL  INTLVL_MED
+
+/// Maximum number of gyros captured at the same time
+#define ADXRS_CAPTURE_MAX  1
+
+/** @brief DMA channel used for capture mode (0 to 2)
+ *
+ * If defined, sensor data commands are transferred by the DMA controller and
+ * a single interrupt is triggered per sample instead of one per byte.
+ * Two channels are used: the configured one and the next one.
+ */
+#undef ADXRS_CAPTURE_DMA_CH
+
+/** @brief Size of the captured sample ring (power of 2, up to 256)
+ *
+ * If defined, each captured sample is stored with a timestamp and can be
+ * retrieved using \ref adxrs_samples_read().
+ */
+#undef ADXRS_SAMPLE_RING_SIZE
+
+/** @brief Integrate captured speeds using sample timestamps
+ *
+ * If defined, the time between samples is measured using
+ * \e ADXRS_TIMESTAMP_TC and speeds are integrated using the trapezoidal rule.
+ * Capture scale then applies to a single timer tick.
+ */
+#define ADXRS_CAPTURE_TIMESTAMP
+
+/** @brief Timer used to timestamp captured samples
+ *
+ * The timer is not configured by the module. It must count over the whole
+ * 16-bit range.
+ */
+#define ADXRS_TIMESTAMP_TC  TCC0
+
+/** @brief Capture commands sent to a gyro between two temperature reads
+ *
+ * If defined, gyro temperature is read during capture, in place of a sensor
+ * data command. Offset is then updated from a bias-vs-temperature model,
+ * fitted on the results of calibrations.
+ */
+#undef ADXRS_TEMPERATURE_PERIOD
+
+/** @brief Number of calibration records stored in EEPROM
+ *
+ * If defined, calibration can be saved and reloaded across resets.
+ */
+#undef ADXRS_CALIBRATION_EEPROM_SLOTS
+
+/** @brief EEPROM address of calibration records
+ *
+ * Records are not allocated by the linker, so that they are kept when the
+ * program changes.
+ */
+#define ADXRS_CALIBRATION_EEPROM_ADDR  0
+
+/// Maximum temperature change to use a stored calibration, in Celsius
+#define ADXRS_CALIBRATION_TEMPERATURE_TOLERANCE  5
+
+/// Number of samples needed to confirm a stored calibration
+#define ADXRS_CALIBRATION_CONFIRM_SAMPLES  16
+
+//@}
+//@}
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+"""Generate a synthetic ADXRS capture trace
+
+The gyro follows a sinusoidal rate, with gaussian noise. Transfer periods
+have a 30% jitter and 0.1% of the responses are corrupted.
+
+Usage: gen_trace.py [transfers [truth_period]] > trace.txt
+"""
+import math
+import random
+import sys
+
+TICK = 1 / 2e6  # timestamp timer period, in seconds
+LSB = math.pi / 180 / 80  # rate of a sensor data LSB, in rad/s
+PERIOD = 50e-6  # mean transfer period, in seconds
+
+
+def parity(v):
+    return bin(v).count('1') & 1
+
+
+def encode(rate):
+    """Encode a sensor data response, see adxrs_replay_encode()"""
+    v = rate & 0xffff
+    d = [0x04 | ((v >> 14) & 3), (v >> 6) & 0xff, (v << 2) & 0xfc, 0]
+    if not parity(d[0] ^ d[1]):
+        d[0] |= 0x10
+    if not parity(d[0] ^ d[1] ^ d[2] ^ d[3]):
+        d[3] |= 0x01
+    return d
+
+
+def main():
+    n = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+    truth_period = int(sys.argv[2]) if len(sys.argv) > 2 else 100
+    random.seed(1)
+    t = 0
+    ticks = 0
+    print("# synthetic trace: %d transfers" % n)
+    for i in range(n):
+        dt = PERIOD * (1 + 0.3 * (2 * random.random() - 1))
+        t += dt
+        ticks += dt / TICK
+        rate = 2.0 * math.sin(0.7 * t)
+        angle = 2.0 / 0.7 * (1 - math.cos(0.7 * t))
+        d = encode(int(round(rate / LSB + random.gauss(0, 0.5))))
+        if random.random() < 0.001:
+            d[2] ^= 0x10  # corrupted response
+        truth = " %.6f" % angle if i % truth_period == 0 else ""
+        print("%u %02x%02x%02x%02x%s" % (int(ticks) & 0xffff, *d, truth))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,48 @@
+/** @file
+ * @brief Replay an ADXRS capture trace and print statistics
+ *
+ * Build and run on host:
+ * @verbatim make && ./adxrs_replay [trace] @endverbatim
+ *
+ * The default trace is \e trace.txt, generated with:
+ * @verbatim ./gen_trace.py 2000 100 > trace.txt @endverbatim
+ *
+ * Traces are recorded with a 2 MHz timestamp timer and an 80 LSB/(deg/s)
+ * gyro sensitivity.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <adxrs/adxrs.h>
+#include <adxrs/adxrs_replay.h>
+
+/// Timestamp timer frequency, in Hz
+#define TIMESTAMP_FREQ  2e6
+/// Gyro sensitivity, in LSB/(deg/s)
+#define GYRO_SENSITIVITY  80
+
+
+int main(int argc, char **argv)
+{
+  const char *filename = argc > 1 ? argv[1] : "trace.txt";
+  FILE *fp = fopen(filename, "r");
+  if(!fp) {
+    perror(filename);
+    return EXIT_FAILURE;
+  }
+
+  adxrs_t gyro;
+  adxrs_init(&gyro, (portpin_t){ NULL, 0 });
+  // scale applies to a single timer tick
+  adxrs_capture_start(&gyro, 1 / TIMESTAMP_FREQ * M_PI / 180 / GYRO_SENSITIVITY);
+  adxrs_replay_reset_stats();
+
+  const int32_t n = adxrs_replay_run(fp, 0);
+  fclose(fp);
+  if(n < 0) {
+    fprintf(stderr, "%s: invalid trace line\n", filename);
+    return EXIT_FAILURE;
+  }
+  adxrs_replay_print_stats(stdout, filename);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+/** @file
+ * @brief Check the AX-12 bus simulator, then run its benchmark
+ *
+ * Build and run on host:
+ * @verbatim make && ./ax12_sim @endverbatim
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <ax12/ax12.h>
+#include <ax12/ax12_sim.h>
+
+
+static int failures = 0;
+
+#define CHECK(expr)  do { \
+    if(!(expr)) { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+      failures++; \
+    } \
+  } while(0)
+
+
+/// Send raw bytes on the simulated bus
+static void send_raw(const uint8_t *data, uint8_t n)
+{
+  ax12_sim.set_state(AX12_STATE_WRITE);
+  for(uint8_t i=0; i<n; i++) {
+    ax12_sim.send(data[i]);
+  }
+  ax12_sim.set_state(AX12_STATE_READ);
+}
+
+
+static void check_instructions(void)
+{
+  uint16_t word;
+  uint8_t byte;
+
+  CHECK(ax12_ping(&ax12_sim, 1) == 0);
+  CHECK(ax12_ping(&ax12_sim, 42) == AX12_ERROR_NO_REPLY);
+
+  CHECK(ax12_write_word(&ax12_sim, 1, AX12_ADDR_GOAL_POSITION_L, 0x123) == 0);
+  CHECK(ax12_read_word(&ax12_sim, 1, AX12_ADDR_GOAL_POSITION_L, &word) == 0);
+  CHECK(word == 0x123);
+  CHECK(ax12_read_word(&ax12_sim, 1, AX12_ADDR_PRESENT_POSITION_L, &word) == 0);
+  CHECK(word == 0x123);
+
+  // SYNC_WRITE
+  const uint8_t ids[] = { 1, 2, 3 };
+  const uint8_t goals[] = { 0x10, 0x01, 0x20, 0x02, 0x30, 0x03 };
+  CHECK(ax12_sync_write(&ax12_sim, AX12_ADDR_GOAL_POSITION_L, 2, 3, ids, goals) == 0);
+  CHECK(ax12_read_word(&ax12_sim, 3, AX12_ADDR_GOAL_POSITION_L, &word) == 0);
+  CHECK(word == 0x330);
+
+  // REG_WRITE is only applied on ACTION
+  const uint8_t goal[] = { 0x00, 0x02 };
+  CHECK(ax12_reg_write_mem(&ax12_sim, 2, AX12_ADDR_GOAL_POSITION_L, 2, goal) == 0);
+  CHECK(ax12_read_word(&ax12_sim, 2, AX12_ADDR_GOAL_POSITION_L, &word) == 0);
+  CHECK(word == 0x220);
+  CHECK(ax12_action(&ax12_sim, AX12_BROADCAST_ID) == 0);
+  CHECK(ax12_read_word(&ax12_sim, 2, AX12_ADDR_GOAL_POSITION_L, &word) == 0);
+  CHECK(word == 0x200);
+
+  // status return level 0: no reply, except on PING
+  ax12_write_byte(&ax12_sim, 3, AX12_ADDR_STATUS_RETURN_LEVEL, 0);
+  CHECK(ax12_read_byte(&ax12_sim, 3, AX12_ADDR_ID, &byte) == AX12_ERROR_NO_REPLY);
+  CHECK(ax12_ping(&ax12_sim, 3) == 0);
+
+  // malformed packets are ignored, bus is still usable afterwards
+  const uint8_t short_length[] = { 0xFF, 0xFF, 0x01, 0x00, 0xFE };
+  send_raw(short_length, sizeof(short_length));
+  const uint8_t bad_checksum[] = { 0xFF, 0xFF, 0x01, 0x02, AX12_INSTR_PING, 0x00 };
+  send_raw(bad_checksum, sizeof(bad_checksum));
+  CHECK(ax12_ping(&ax12_sim, 1) == 0);
+}
+
+
+int main(void)
+{
+  ax12_sim_init(1000000, 1000);
+  for(uint8_t id=1; id<=3; id++) {
+    CHECK(ax12_sim_add(id) != NULL);
+  }
+  check_instructions();
+  if(failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+
+  ax12_sim_init(1000000, 1000);
+  ax12_sim_benchmark(stdout, 12);
+  ax12_sim_init(57600, 1000);
+  ax12_sim_benchmark(stdout, 12);
+  return EXIT_SUCCESS;
+}